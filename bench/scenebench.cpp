@@ -0,0 +1,287 @@
+// Headless frame benchmark. Builds a TreeWidget / SnowOverlay scene from a
+// JSON script, renders a fixed number of frames into QImages on the offscreen
+// platform and reports per-subsystem update and paint times as JSON.
+//
+//   ChristmasBench bench/scenes/default.json -o result.json
+
+#include "qualitygovernor.h"
+#include "rng.h"
+#include "snowoverlay.h"
+#include "snowsimulation.h"
+#include "treewidget.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+namespace {
+
+const char *kDefaultScene = R"({
+  "tree": "classic",
+  "frames": 300,
+  "warmup": 10,
+  "dt": 0.016667,
+  "renderer": "painter",
+  "ornaments": { "red": 20, "gold": 20, "blue": 20, "silver": 20,
+                 "purple": 20, "star": 5 },
+  "messages": [12, 30],
+  "gifts": 20,
+  "snow": { "back": 200, "front": 200 }
+})";
+
+const QHash<QString, OrnamentType> kOrnamentNames = {
+    {"red", OrnamentType::Red},       {"gold", OrnamentType::Gold},
+    {"blue", OrnamentType::Blue},     {"silver", OrnamentType::Silver},
+    {"purple", OrnamentType::Purple}, {"star", OrnamentType::Star},
+};
+
+const QHash<QString, TreeType> kTreeNames = {
+    {"classic", TreeType::Classic},
+    {"snowy", TreeType::Snowy},
+    {"dark", TreeType::Dark},
+    {"procedural", TreeType::Procedural},
+};
+
+struct Series {
+  QString name;
+  QVector<double> ms;
+};
+
+QJsonObject summarize(QVector<double> ms) {
+  QJsonObject out;
+  if (ms.isEmpty())
+    return out;
+  std::sort(ms.begin(), ms.end());
+  double sum = 0;
+  for (double v : ms)
+    sum += v;
+  auto at = [&](double q) {
+    int last = static_cast<int>(ms.size()) - 1;
+    int idx = std::min(static_cast<int>(q * ms.size()), last);
+    return ms[idx];
+  };
+  out["min"] = ms.first();
+  out["median"] = at(0.5);
+  out["p99"] = at(0.99);
+  out["max"] = ms.last();
+  out["mean"] = sum / ms.size();
+  return out;
+}
+
+template <typename F> double timeMs(F &&fn) {
+  QElapsedTimer timer;
+  timer.start();
+  fn();
+  return timer.nsecsElapsed() / 1e6;
+}
+
+QPointF randomTreePoint(const TreeWidget &tree, Rng &rng) {
+  for (int attempt = 0; attempt < 1000; ++attempt) {
+    QPointF p(rng.bounded(400.0), rng.bounded(450.0));
+    if (tree.isOnTree(p))
+      return p;
+  }
+  return QPointF(200, 300);
+}
+
+QString messageText(int length) {
+  const QString source = QStringLiteral("MUTLU YILLAR MERRY CHRISTMAS ");
+  QString text;
+  while (text.length() < length)
+    text += source;
+  return text.left(length);
+}
+
+// Whether anything was drawn into an image rendered by renderInto()
+bool hasInk(const QImage &image) {
+  for (int y = 0; y < image.height(); ++y) {
+    const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+    for (int x = 0; x < image.width(); ++x) {
+      if (qAlpha(line[x]) != 0)
+        return true;
+    }
+  }
+  return false;
+}
+
+void renderInto(QWidget &widget, QImage &image) {
+  QSize pixelSize = widget.size() * widget.devicePixelRatioF();
+  if (image.size() != pixelSize) {
+    image = QImage(pixelSize, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(widget.devicePixelRatioF());
+  }
+  image.fill(Qt::transparent);
+  widget.render(&image);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+
+  // Step the snow inline so its cost is attributed to the snow rows. The
+  // update rows then include rasterization; paint is only the final blit.
+  SnowSimulation::setThreaded(false);
+  // Measure the requested scene, not whatever the governor would settle on
+  QualityGovernor::instance()->setBudget(0);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Headless Christmas overlay benchmark");
+  parser.addHelpOption();
+  parser.addPositionalArgument("script", "Scene script (JSON).", "[script]");
+  QCommandLineOption outputOption({"o", "output"},
+                                  "Write the report to <file>.", "file");
+  parser.addOption(outputOption);
+  parser.process(app);
+
+  QByteArray scriptData = kDefaultScene;
+  if (!parser.positionalArguments().isEmpty()) {
+    QFile file(parser.positionalArguments().first());
+    if (!file.open(QIODevice::ReadOnly)) {
+      std::fprintf(stderr, "Cannot open %s\n", qPrintable(file.fileName()));
+      return 1;
+    }
+    scriptData = file.readAll();
+  }
+
+  QJsonParseError error;
+  QJsonObject script = QJsonDocument::fromJson(scriptData, &error).object();
+  if (error.error != QJsonParseError::NoError) {
+    std::fprintf(stderr, "Invalid scene script: %s\n",
+                 qPrintable(error.errorString()));
+    return 1;
+  }
+
+  const int frames = script.value("frames").toInt(300);
+  const int warmup = script.value("warmup").toInt(10);
+  const float dt = script.value("dt").toDouble(1.0 / 60.0);
+  // Seeds every subsystem too, so repeated runs replay the same scene
+  Rng::setSeed(script.value("seed").toInt(1));
+  Rng rng = Rng::forSubsystem("bench");
+
+  TreeWidget tree;
+  SnowOverlay backSnow(false);
+  SnowOverlay frontSnow(true);
+  tree.setSnowLayers(&backSnow, &frontSnow);
+  tree.setTreeType(kTreeNames.value(script.value("tree").toString("classic"),
+                                    TreeType::Classic));
+
+  if (script.value("renderer").toString() == "splat") {
+    backSnow.setRenderBackend(SnowRenderBackend::Splat);
+    frontSnow.setRenderBackend(SnowRenderBackend::Splat);
+  }
+
+  const QJsonObject ornaments = script.value("ornaments").toObject();
+  for (auto it = ornaments.begin(); it != ornaments.end(); ++it) {
+    if (!kOrnamentNames.contains(it.key())) {
+      std::fprintf(stderr, "Unknown ornament type: %s\n",
+                   qPrintable(it.key()));
+      return 1;
+    }
+    for (int i = 0; i < it.value().toInt(); ++i)
+      tree.addOrnament(randomTreePoint(tree, rng), kOrnamentNames[it.key()]);
+  }
+
+  for (const QJsonValue &length : script.value("messages").toArray()) {
+    tree.addOrnament(randomTreePoint(tree, rng), OrnamentType::Message,
+                     messageText(length.toInt()));
+  }
+
+  const GiftColor giftColors[] = {GiftColor::Red, GiftColor::Blue,
+                                  GiftColor::Gold};
+  const GiftSize giftSizes[] = {GiftSize::Small, GiftSize::Medium,
+                                GiftSize::Large};
+  const int gifts = script.value("gifts").toInt();
+  for (int i = 0; i < gifts; ++i) {
+    QPointF pos(20 + rng.bounded(360.0), rng.bounded(300.0));
+    tree.addGift(pos, giftColors[i % 3], giftSizes[(i / 3) % 3]);
+  }
+
+  const QJsonObject snow = script.value("snow").toObject();
+  backSnow.changeSnowIntensity(snow.value("back").toInt(200) -
+                               backSnow.snowflakeCount());
+  frontSnow.changeSnowIntensity(snow.value("front").toInt(200) -
+                                frontSnow.snowflakeCount());
+
+  Series treeUpdate{"tree.update", {}};
+  Series treePaint{"tree.paint", {}};
+  Series backUpdate{"snow.back.update", {}};
+  Series backPaint{"snow.back.paint", {}};
+  Series frontUpdate{"snow.front.update", {}};
+  Series frontPaint{"snow.front.paint", {}};
+  Series frame{"frame", {}};
+
+  // The overlays are never shown. Stepping them directly bypasses the
+  // FrameClock's on-screen gating, so they simulate as a visible layer would.
+  QImage treeImage, backImage, frontImage;
+  for (int i = 0; i < warmup + frames; ++i) {
+    double tu = timeMs([&] { tree.updateAnimations(dt); });
+    double bu = timeMs([&] { backSnow.updateSnow(dt); });
+    double fu = timeMs([&] { frontSnow.updateSnow(dt); });
+    double bp = timeMs([&] { renderInto(backSnow, backImage); });
+    double tp = timeMs([&] { renderInto(tree, treeImage); });
+    double fp = timeMs([&] { renderInto(frontSnow, frontImage); });
+    if (i < warmup)
+      continue;
+    treeUpdate.ms.append(tu);
+    backUpdate.ms.append(bu);
+    frontUpdate.ms.append(fu);
+    backPaint.ms.append(bp);
+    treePaint.ms.append(tp);
+    frontPaint.ms.append(fp);
+    frame.ms.append(tu + bu + fu + bp + tp + fp);
+  }
+
+  // Guard against timing empty snow rows: a layer with flakes must have
+  // drawn some of them
+  const std::pair<const SnowOverlay *, const QImage *> layers[] = {
+      {&backSnow, &backImage}, {&frontSnow, &frontImage}};
+  for (const auto &[layer, image] : layers) {
+    if (warmup + frames > 0 && layer->snowflakeCount() > 0 &&
+        !hasInk(*image)) {
+      std::fprintf(stderr, "Snow layer rendered no flakes\n");
+      return 1;
+    }
+  }
+
+  QJsonObject subsystems;
+  for (const Series *s : {&treeUpdate, &treePaint, &backUpdate, &backPaint,
+                          &frontUpdate, &frontPaint, &frame}) {
+    subsystems[s->name] = summarize(s->ms);
+  }
+
+  QJsonObject counts;
+  counts["ornaments"] = tree.ornamentCount();
+  counts["gifts"] = tree.giftCount();
+  counts["snow.back"] = backSnow.snowflakeCount();
+  counts["snow.front"] = frontSnow.snowflakeCount();
+
+  QJsonObject report;
+  report["frames"] = frames;
+  report["unit"] = "ms";
+  report["counts"] = counts;
+  report["subsystems"] = subsystems;
+
+  QByteArray json = QJsonDocument(report).toJson();
+  if (parser.isSet(outputOption)) {
+    QFile out(parser.value(outputOption));
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      std::fprintf(stderr, "Cannot write %s\n", qPrintable(out.fileName()));
+      return 1;
+    }
+    out.write(json);
+  } else {
+    std::fwrite(json.constData(), 1, json.size(), stdout);
+  }
+  return 0;
+}
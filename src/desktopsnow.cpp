@@ -0,0 +1,114 @@
+#include "desktopsnow.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Flake counts are specified for the classic 400 px column on a 1080p screen
+constexpr double kColumnArea = 400.0 * 1080.0;
+
+int flakesFor(int columnFlakes, const QRect &area) {
+  double share = double(area.width()) * area.height() / kColumnArea;
+  return static_cast<int>(std::lround(columnFlakes * share));
+}
+} // namespace
+
+DesktopSnow::DesktopSnow(QObject *parent) : QObject(parent) {
+  for (QScreen *screen : QGuiApplication::screens())
+    addScreen(screen);
+
+  connect(qApp, &QGuiApplication::screenAdded, this, &DesktopSnow::addScreen);
+  connect(qApp, &QGuiApplication::screenRemoved, this,
+          &DesktopSnow::removeScreen);
+}
+
+DesktopSnow::~DesktopSnow() {
+  for (const ScreenLayers &layers : std::as_const(m_screens)) {
+    delete layers.back;
+    delete layers.front;
+  }
+}
+
+void DesktopSnow::setRenderBackend(SnowRenderBackend backend) {
+  m_backend = backend;
+  for (const ScreenLayers &layers : std::as_const(m_screens)) {
+    layers.back->setRenderBackend(backend);
+    layers.front->setRenderBackend(backend);
+  }
+}
+
+void DesktopSnow::changeSnowIntensity(int backDelta, int frontDelta) {
+  m_backColumnFlakes = std::max(0, m_backColumnFlakes + backDelta);
+  m_frontColumnFlakes = std::max(0, m_frontColumnFlakes + frontDelta);
+  for (const ScreenLayers &layers : std::as_const(m_screens))
+    layout(layers);
+}
+
+void DesktopSnow::showBack() {
+  m_backShown = true;
+  for (const ScreenLayers &layers : std::as_const(m_screens))
+    layers.back->show();
+}
+
+void DesktopSnow::showFront() {
+  m_frontShown = true;
+  for (const ScreenLayers &layers : std::as_const(m_screens))
+    layers.front->show();
+}
+
+void DesktopSnow::raiseFront() {
+  for (const ScreenLayers &layers : std::as_const(m_screens))
+    layers.front->raise();
+}
+
+void DesktopSnow::addScreen(QScreen *screen) {
+  ScreenLayers layers;
+  layers.screen = screen;
+  layers.back = new SnowOverlay(false);
+  layers.front = new SnowOverlay(true);
+  for (SnowOverlay *overlay : {layers.back, layers.front}) {
+    overlay->setScreen(screen);
+    overlay->setRenderBackend(m_backend);
+  }
+  layout(layers);
+  m_screens.append(layers);
+
+  connect(screen, &QScreen::geometryChanged, this, [this, screen]() {
+    for (const ScreenLayers &layers : std::as_const(m_screens)) {
+      if (layers.screen == screen)
+        layout(layers);
+    }
+  });
+
+  // Hot-plugged screens join the current stacking: back snow stays below the
+  // tree, front snow above it
+  if (m_backShown)
+    layers.back->show();
+  if (m_frontShown) {
+    layers.front->show();
+    layers.front->raise();
+  }
+}
+
+void DesktopSnow::removeScreen(QScreen *screen) {
+  for (int i = 0; i < m_screens.size(); ++i) {
+    if (m_screens[i].screen != screen)
+      continue;
+    // Deferred: the platform may still deliver events for these windows
+    m_screens[i].back->deleteLater();
+    m_screens[i].front->deleteLater();
+    m_screens.removeAt(i);
+    return;
+  }
+}
+
+void DesktopSnow::layout(const ScreenLayers &layers) {
+  if (!layers.screen)
+    return;
+  QRect area = layers.screen->geometry();
+  layers.back->setSnowArea(area);
+  layers.front->setSnowArea(area);
+  layers.back->setSnowflakeCount(flakesFor(m_backColumnFlakes, area));
+  layers.front->setSnowflakeCount(flakesFor(m_frontColumnFlakes, area));
+}
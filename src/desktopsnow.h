@@ -0,0 +1,58 @@
+#ifndef DESKTOPSNOW_H
+#define DESKTOPSNOW_H
+
+#include "snowoverlay.h"
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+class QScreen;
+
+// Snow over the whole desktop: one back and one front overlay per connected
+// screen, each sized to that screen and rendered at its own pixel ratio.
+// The flake budget is a density shared by all screens, so every screen gets
+// a share proportional to its area. Layers on hidden or covered screens
+// stop stepping, so work follows the visible area. Screens can be plugged
+// in or removed while running.
+class DesktopSnow : public QObject {
+  Q_OBJECT
+public:
+  explicit DesktopSnow(QObject *parent = nullptr);
+  ~DesktopSnow() override;
+
+  void setRenderBackend(SnowRenderBackend backend);
+  // Deltas are in flakes per default 400 px column, as in column mode
+  void changeSnowIntensity(int backDelta, int frontDelta);
+  int backColumnFlakes() const { return m_backColumnFlakes; }
+  int frontColumnFlakes() const { return m_frontColumnFlakes; }
+  // Front overlays, one per screen, for the snow cover's colliders
+  int screenCount() const { return m_screens.size(); }
+  SnowOverlay *frontLayer(int screen) const {
+    return m_screens[screen].front;
+  }
+
+  // The tree window is shown between the two so it sits in the middle
+  void showBack();
+  void showFront();
+  void raiseFront();
+
+private:
+  struct ScreenLayers {
+    QPointer<QScreen> screen;
+    SnowOverlay *back = nullptr;
+    SnowOverlay *front = nullptr;
+  };
+
+  void addScreen(QScreen *screen);
+  void removeScreen(QScreen *screen);
+  void layout(const ScreenLayers &layers);
+
+  QVector<ScreenLayers> m_screens;
+  int m_backColumnFlakes = 200;
+  int m_frontColumnFlakes = 200;
+  SnowRenderBackend m_backend = SnowRenderBackend::Painter;
+  bool m_backShown = false;
+  bool m_frontShown = false;
+};
+
+#endif // DESKTOPSNOW_H
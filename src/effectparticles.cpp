@@ -0,0 +1,264 @@
+#include "effectparticles.h"
+#include "sinetable.h"
+#include <QPainter>
+#include <QRegion>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+constexpr float kSparkleRate = 5.0f; // per star per second
+constexpr float kSparkleRise = 12.0f;
+
+constexpr float kConfettiGravity = 600.0f;
+constexpr float kConfettiDrag = 1.5f; // velocity share lost per second
+const QRgb kConfettiColors[] = {qRgb(230, 40, 60), qRgb(255, 205, 40),
+                                qRgb(40, 170, 90), qRgb(50, 130, 240),
+                                qRgb(240, 240, 240)};
+
+constexpr float kGlitterSpacing = 5.0f; // px of drag per grain
+constexpr float kGlitterGravity = 200.0f;
+constexpr int kMaxGlitterPerMove = 16;
+
+// Dirty clusters: a particle joins a cluster it touches (give or take the
+// gap) while the cluster stays within the side limit. Beyond the count
+// limit a kind repaints its bounding rect instead.
+constexpr float kClusterGap = 8.0f;
+constexpr float kMaxClusterSide = 96.0f;
+constexpr int kMaxClusters = 24;
+} // namespace
+
+EffectParticles::EffectParticles(int capacity) : m_budget(capacity) {
+  m_pool.resize(capacity);
+  m_free.reserve(capacity);
+  for (int i = capacity - 1; i >= 0; --i)
+    m_free.append(i);
+  for (QVector<int> &alive : m_alive)
+    alive.reserve(capacity);
+}
+
+void EffectParticles::setBudget(int budget) {
+  m_budget = std::clamp(budget, 0, capacity());
+}
+
+EffectParticles::Particle *EffectParticles::spawn(Kind kind) {
+  if (m_live >= m_budget || m_free.isEmpty())
+    return nullptr;
+  int slot = m_free.takeLast();
+  m_alive[kind].append(slot);
+  ++m_live;
+  Particle &p = m_pool[slot];
+  p = Particle{};
+  return &p;
+}
+
+void EffectParticles::sparkle(const QPointF &center, float radius, float dt) {
+  // Bernoulli per frame keeps the average rate at any frame rate
+  if (m_rng.generateDouble() >= kSparkleRate * dt)
+    return;
+  Particle *p = spawn(Sparkle);
+  if (!p)
+    return;
+  float angle = m_rng.bounded(2.0 * M_PI);
+  float distance = radius * std::sqrt(m_rng.generateFloat());
+  p->x = center.x() + distance * std::cos(angle);
+  p->y = center.y() + distance * std::sin(angle);
+  p->vy = -kSparkleRise;
+  p->life = 0.5f + m_rng.generateFloat() * 0.4f;
+  p->size = 3.0f + m_rng.generateFloat() * 2.0f;
+  p->color = qRgb(255, 250, 210);
+}
+
+void EffectParticles::confetti(const QPointF &pos, int count) {
+  for (int i = 0; i < count; ++i) {
+    Particle *p = spawn(Confetti);
+    if (!p)
+      return;
+    p->x = pos.x();
+    p->y = pos.y();
+    p->vx = (m_rng.generateFloat() - 0.5f) * 240.0f;
+    p->vy = -150.0f - m_rng.generateFloat() * 150.0f;
+    p->life = 1.2f + m_rng.generateFloat() * 0.6f;
+    p->size = 2.5f + m_rng.generateFloat() * 2.0f;
+    p->angle = m_rng.bounded(2.0 * M_PI);
+    p->spin = (m_rng.generateFloat() - 0.5f) * 16.0f;
+    p->color = kConfettiColors[m_rng.bounded(int(std::size(kConfettiColors)))];
+  }
+}
+
+void EffectParticles::glitter(const QPointF &from, const QPointF &to,
+                              const QColor &color) {
+  QPointF travel = to - from;
+  float length = std::hypot(travel.x(), travel.y());
+  int count = std::min(kMaxGlitterPerMove,
+                       static_cast<int>(length / kGlitterSpacing) + 1);
+  QRgb rgb = color.lighter(130).rgb();
+  for (int i = 0; i < count; ++i) {
+    Particle *p = spawn(Glitter);
+    if (!p)
+      return;
+    QPointF at = from + travel * ((i + m_rng.generateFloat()) / count);
+    p->x = at.x() + (m_rng.generateFloat() - 0.5f) * 8.0f;
+    p->y = at.y() + (m_rng.generateFloat() - 0.5f) * 8.0f;
+    p->vx = (m_rng.generateFloat() - 0.5f) * 60.0f;
+    p->vy = 20.0f + m_rng.generateFloat() * 40.0f;
+    p->life = 0.4f + m_rng.generateFloat() * 0.3f;
+    p->size = 1.0f + m_rng.generateFloat();
+    p->color = rgb;
+  }
+}
+
+void EffectParticles::clear() {
+  for (QVector<int> &alive : m_alive) {
+    m_free.append(alive);
+    alive.clear();
+  }
+  m_live = 0;
+}
+
+template <typename Kernel>
+void EffectParticles::updateKind(Kind kind, float dt, Kernel step) {
+  QVector<int> &alive = m_alive[kind];
+  float left = INFINITY, top = INFINITY, right = -INFINITY, bottom = -INFINITY;
+  m_scratch.clear();
+  for (int i = 0; i < alive.size();) {
+    Particle &p = m_pool[alive[i]];
+    p.age += dt;
+    if (p.age >= p.life) {
+      // Swap-remove; order within a kind does not matter
+      m_free.append(alive[i]);
+      alive[i] = alive.last();
+      alive.removeLast();
+      --m_live;
+      continue;
+    }
+    step(p, dt);
+    // Rotated confetti reaches ~1.2 size from its centre
+    float reach = p.size * 1.5f;
+    left = std::min(left, p.x - reach);
+    top = std::min(top, p.y - reach);
+    right = std::max(right, p.x + reach);
+    bottom = std::max(bottom, p.y + reach);
+    ++i;
+
+    if (m_scratch.size() > kMaxClusters)
+      continue; // Falling back to the bounds anyway
+    QRectF area(p.x - reach, p.y - reach, 2 * reach, 2 * reach);
+    QRectF padded = area.adjusted(-kClusterGap, -kClusterGap, kClusterGap,
+                                  kClusterGap);
+    bool joined = false;
+    for (QRectF &cluster : m_scratch) {
+      if (!cluster.intersects(padded))
+        continue;
+      QRectF grown = cluster.united(area);
+      if (grown.width() > kMaxClusterSide || grown.height() > kMaxClusterSide)
+        continue;
+      cluster = grown;
+      joined = true;
+      break;
+    }
+    if (!joined)
+      m_scratch.append(area);
+  }
+
+  QVector<QRect> &clusters = m_clusters[kind];
+  clusters.clear();
+  if (alive.isEmpty()) {
+    m_bounds[kind] = QRect();
+    return;
+  }
+  m_bounds[kind] =
+      QRectF(left, top, right - left, bottom - top).toAlignedRect();
+  if (m_scratch.size() > kMaxClusters) {
+    clusters.append(m_bounds[kind]);
+    return;
+  }
+  for (const QRectF &cluster : std::as_const(m_scratch))
+    clusters.append(cluster.toAlignedRect());
+}
+
+void EffectParticles::update(float dt, QRegion &dirty) {
+  // Where particles were painted last frame, before the kernels move them
+  for (const QVector<QRect> &clusters : m_clusters) {
+    for (const QRect &cluster : clusters)
+      dirty += cluster;
+  }
+
+  // One kernel per kind, each a tight loop over that kind's live list
+  updateKind(Sparkle, dt, [](Particle &p, float h) { p.y += p.vy * h; });
+  updateKind(Confetti, dt, [](Particle &p, float h) {
+    float drag = std::max(0.0f, 1.0f - kConfettiDrag * h);
+    p.vx *= drag;
+    p.vy = p.vy * drag + kConfettiGravity * h;
+    p.x += p.vx * h;
+    p.y += p.vy * h;
+    p.angle += p.spin * h;
+  });
+  updateKind(Glitter, dt, [](Particle &p, float h) {
+    p.vy += kGlitterGravity * h;
+    p.x += p.vx * h;
+    p.y += p.vy * h;
+  });
+
+  for (const QVector<QRect> &clusters : m_clusters) {
+    for (const QRect &cluster : clusters)
+      dirty += cluster;
+  }
+}
+
+void EffectParticles::draw(QPainter &painter, const QRegion &dirty) const {
+  painter.save();
+  painter.setPen(Qt::NoPen);
+  if (!m_alive[Sparkle].isEmpty() && dirty.intersects(m_bounds[Sparkle]))
+    drawSparkles(painter);
+  if (!m_alive[Confetti].isEmpty() && dirty.intersects(m_bounds[Confetti]))
+    drawConfetti(painter);
+  if (!m_alive[Glitter].isEmpty() && dirty.intersects(m_bounds[Glitter]))
+    drawGlitter(painter);
+  painter.restore();
+}
+
+void EffectParticles::drawSparkles(QPainter &painter) const {
+  // A four-pointed glint that swells and fades over its life
+  for (int slot : m_alive[Sparkle]) {
+    const Particle &p = m_pool[slot];
+    float t = tableSin(M_PI * p.age / p.life);
+    QColor color = QColor::fromRgb(p.color);
+    color.setAlphaF(t);
+    float arm = p.size * t;
+    painter.fillRect(QRectF(p.x - arm, p.y - 0.6f, 2 * arm, 1.2f), color);
+    painter.fillRect(QRectF(p.x - 0.6f, p.y - arm, 1.2f, 2 * arm), color);
+  }
+}
+
+void EffectParticles::drawConfetti(QPainter &painter) const {
+  for (int slot : m_alive[Confetti]) {
+    const Particle &p = m_pool[slot];
+    QColor color = QColor::fromRgb(p.color);
+    float fade = (p.life - p.age) / (0.3f * p.life); // Last 30% of life
+    color.setAlphaF(std::min(1.0f, fade));
+    painter.setBrush(color);
+
+    // A paper strip tumbling in 3D: rotated in plane, foreshortened by flip
+    float c = std::cos(p.angle), s = std::sin(p.angle);
+    float hw = p.size;
+    float hh = p.size * 0.5f * std::fabs(tableSin(p.angle * 1.7f)) + 0.3f;
+    QPointF corners[4] = {
+        {p.x + (-hw * c + hh * s), p.y + (-hw * s - hh * c)},
+        {p.x + (hw * c + hh * s), p.y + (hw * s - hh * c)},
+        {p.x + (hw * c - hh * s), p.y + (hw * s + hh * c)},
+        {p.x + (-hw * c - hh * s), p.y + (-hw * s + hh * c)},
+    };
+    painter.drawPolygon(corners, 4);
+  }
+}
+
+void EffectParticles::drawGlitter(QPainter &painter) const {
+  for (int slot : m_alive[Glitter]) {
+    const Particle &p = m_pool[slot];
+    QColor color = QColor::fromRgb(p.color);
+    color.setAlphaF(1.0f - p.age / p.life);
+    painter.fillRect(QRectF(p.x - p.size / 2, p.y - p.size / 2, p.size, p.size),
+                     color);
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef EFFECTPARTICLES_H
+#define EFFECTPARTICLES_H
+
+#include "rng.h"
+#include <QColor>
+#include <QRect>
+#include <QVector>
+
+class QPainter;
+class QRegion;
+
+// Short-lived decoration particles: sparkles around stars, confetti when a
+// gift lands and glitter behind a dragged ornament. All kinds share one
+// arena allocated up front; dead slots go back on a free list and the live
+// lists only swap-remove, so the frame loop never allocates. When the arena
+// or the budget is exhausted new particles are simply dropped.
+class EffectParticles {
+public:
+  explicit EffectParticles(int capacity = 2048);
+
+  // Live particle limit, at most the capacity (the quality governor trims it)
+  void setBudget(int budget);
+  int capacity() const { return m_pool.size(); }
+  int size() const { return m_live; }
+  bool isEmpty() const { return m_live == 0; }
+
+  // Emitters. Sparkles are rate based, so call once per frame per star.
+  void sparkle(const QPointF &center, float radius, float dt);
+  void confetti(const QPointF &pos, int count);
+  void glitter(const QPointF &from, const QPointF &to, const QColor &color);
+  void clear();
+
+  // Advances every kind and adds the area to repaint: old and new clusters
+  // of nearby particles, so far-apart effects do not dirty the gap between
+  void update(float dt, QRegion &dirty);
+  void draw(QPainter &painter, const QRegion &dirty) const;
+
+private:
+  enum Kind { Sparkle, Confetti, Glitter, KindCount };
+
+  struct Particle {
+    float x, y;
+    float vx, vy;   // px/s
+    float age;      // s
+    float life;     // s
+    float size;     // px
+    float angle;    // radians, confetti only
+    float spin;     // radians/s, confetti only
+    QRgb color;
+  };
+
+  Particle *spawn(Kind kind);
+  template <typename Kernel> void updateKind(Kind kind, float dt, Kernel step);
+  void drawSparkles(QPainter &painter) const;
+  void drawConfetti(QPainter &painter) const;
+  void drawGlitter(QPainter &painter) const;
+
+  QVector<Particle> m_pool;
+  QVector<int> m_free;             // Unused slots of m_pool
+  QVector<int> m_alive[KindCount]; // Live slots per kind
+  QRect m_bounds[KindCount];       // Last painted area per kind
+  QVector<QRect> m_clusters[KindCount]; // Its parts, as added to dirty
+  QVector<QRectF> m_scratch;            // Clusters being grown
+  int m_live = 0;
+  int m_budget;
+  Rng m_rng = Rng::forSubsystem("effects");
+};
+
+#endif // EFFECTPARTICLES_H
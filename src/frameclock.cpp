@@ -0,0 +1,255 @@
+#include "frameclock.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include <QDir>
+#include <QEvent>
+#include <QFile>
+#include <QGuiApplication>
+#include <QWidget>
+#include <QWindow>
+#include <algorithm>
+#include <cmath>
+
+#ifdef Q_OS_WIN
+// Keep windows.h from defining min/max macros over std::min/std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+// Longest step handed to subscribers; larger gaps (suspend, debugger) would
+// otherwise teleport flakes and gifts.
+constexpr float kMaxFrameSeconds = 0.1f;
+
+// Frame rate ceiling on battery power
+constexpr double kBatteryHz = 30.0;
+
+// Power source changes are rare; polling once a minute is a negligible
+// wakeup cost.
+constexpr int kPowerPollMs = 60000;
+
+bool detectBatteryPower() {
+#if defined(Q_OS_WIN)
+  SYSTEM_POWER_STATUS status;
+  return GetSystemPowerStatus(&status) && status.ACLineStatus == 0;
+#elif defined(Q_OS_LINUX)
+  // An AC adapter's online flag is authoritative. Without one, a system
+  // battery that is discharging decides. Wireless mice, keyboards and pads
+  // list their batteries here too (scope "Device"), and they are always
+  // discharging, so they are ignored.
+  QDir supplies("/sys/class/power_supply");
+  const auto entries = supplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+  bool hasMains = false, mainsOnline = false, discharging = false;
+  for (const QString &name : entries) {
+    auto read = [&](const char *attribute) {
+      QFile file(supplies.filePath(name + '/' + attribute));
+      return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed()
+                                            : QByteArray();
+    };
+    if (read("scope") == "Device")
+      continue;
+    const QByteArray type = read("type");
+    if (type == "Mains") {
+      hasMains = true;
+      mainsOnline = mainsOnline || read("online") == "1";
+    } else if (type == "Battery" && read("status") == "Discharging") {
+      discharging = true;
+    }
+  }
+  return hasMains ? !mainsOnline : discharging;
+#else
+  return false;
+#endif
+}
+} // namespace
+
+FrameClock *FrameClock::instance() {
+  static FrameClock *clock = new FrameClock(qApp);
+  return clock;
+}
+
+FrameClock::FrameClock(QObject *parent) : QObject(parent) {
+  m_timer.setTimerType(Qt::PreciseTimer);
+  m_timer.setSingleShot(true); // Re-armed against the deadline every frame
+  connect(&m_timer, &QTimer::timeout, this, &FrameClock::tick);
+
+  m_powerTimer.setTimerType(Qt::VeryCoarseTimer);
+  connect(&m_powerTimer, &QTimer::timeout, this, &FrameClock::pollPowerSource);
+  m_powerTimer.start(kPowerPollMs);
+  m_onBattery = detectBatteryPower();
+
+  trackScreen(QGuiApplication::primaryScreen());
+  connect(qApp, &QGuiApplication::primaryScreenChanged, this,
+          &FrameClock::trackScreen);
+
+  connect(qApp, &QGuiApplication::applicationStateChanged, this,
+          [this](Qt::ApplicationState state) {
+            m_suspended = state == Qt::ApplicationSuspended ||
+                          state == Qt::ApplicationHidden;
+            reschedule();
+          });
+
+  m_elapsed.start();
+  m_lastNs = m_elapsed.nsecsElapsed();
+}
+
+double FrameClock::time() const { return m_elapsed.nsecsElapsed() / 1e9; }
+
+void FrameClock::registerSource(QWidget *widget,
+                                std::function<bool()> isAnimating,
+                                std::function<void(float)> step) {
+  m_sources.append({widget, std::move(isAnimating), std::move(step)});
+  // Show/Hide on the widget, Expose (occlusion, screen lock) on its window
+  widget->installEventFilter(this);
+  reschedule();
+}
+
+void FrameClock::wake() { reschedule(); }
+
+bool FrameClock::eventFilter(QObject *watched, QEvent *event) {
+  switch (event->type()) {
+  case QEvent::Show:
+    if (auto *widget = qobject_cast<QWidget *>(watched)) {
+      if (QWindow *window = widget->window()->windowHandle())
+        window->installEventFilter(this);
+    }
+    reschedule();
+    break;
+  case QEvent::Hide:
+  case QEvent::Expose:
+    reschedule();
+    break;
+  default:
+    break;
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+void FrameClock::reschedule() {
+  // Overlays come and go with screens; forget the ones that were deleted
+  m_sources.removeIf([](const Source &source) { return !source.widget; });
+
+  bool live = false;
+  if (!m_suspended) {
+    for (const Source &source : std::as_const(m_sources)) {
+      if (!isOnScreen(source.widget))
+        continue;
+      if (source.isAnimating()) {
+        live = true;
+        break;
+      }
+    }
+  }
+
+  if (live && !m_running) {
+    // Resume without replaying the idle gap
+    m_running = true;
+    m_lastNs = m_elapsed.nsecsElapsed();
+    m_deadlineNs = m_lastNs + m_periodNs;
+    scheduleNext();
+  } else if (!live && m_running) {
+    m_running = false;
+    m_timer.stop();
+  }
+}
+
+bool FrameClock::isOnScreen(const QWidget *widget) {
+  if (!widget || !widget->isVisible())
+    return false;
+  QWindow *window = widget->window()->windowHandle();
+  return !window || window->isExposed();
+}
+
+void FrameClock::trackScreen(QScreen *screen) {
+  if (m_screen)
+    disconnect(m_screen, nullptr, this, nullptr);
+  m_screen = screen;
+  applyInterval();
+
+  if (m_screen)
+    connect(m_screen, &QScreen::refreshRateChanged, this,
+            &FrameClock::applyInterval);
+}
+
+void FrameClock::applyInterval() {
+  double hz = m_screen ? m_screen->refreshRate() : 60.0;
+  if (hz < 1.0)
+    hz = 60.0;
+  if (m_onBattery)
+    hz = std::min(hz, kBatteryHz);
+  if (m_frameRateCap > 0)
+    hz = std::min(hz, double(m_frameRateCap));
+  // Kept exact; only each single wait is rounded to the timer's millisecond
+  m_periodNs = static_cast<qint64>(1e9 / hz);
+}
+
+void FrameClock::scheduleNext() {
+  // Rounded down: a frame that is a fraction early is shown on the same
+  // refresh, one that is late may miss it. Early wakeups do not drift,
+  // because the next deadline is counted from this one rather than from now.
+  qint64 wait = m_deadlineNs - m_elapsed.nsecsElapsed();
+  m_timer.start(static_cast<int>(std::max<qint64>(0, wait) / 1000000));
+}
+
+void FrameClock::setFrameRateCap(int hz) {
+  if (hz == m_frameRateCap)
+    return;
+  m_frameRateCap = hz;
+  applyInterval();
+}
+
+void FrameClock::pollPowerSource() {
+  recordWakeup();
+  bool onBattery = detectBatteryPower();
+  if (onBattery != m_onBattery) {
+    m_onBattery = onBattery;
+    applyInterval();
+  }
+}
+
+void FrameClock::recordWakeup() {
+  qint64 now = m_elapsed.nsecsElapsed();
+  m_wakeups.enqueue(now);
+  while (!m_wakeups.isEmpty() && now - m_wakeups.head() > 1000000000LL)
+    m_wakeups.dequeue();
+}
+
+double FrameClock::wakeupsPerSecond() {
+  qint64 now = m_elapsed.nsecsElapsed();
+  while (!m_wakeups.isEmpty() && now - m_wakeups.head() > 1000000000LL)
+    m_wakeups.dequeue();
+  return m_wakeups.size();
+}
+
+void FrameClock::tick() {
+  recordWakeup();
+  qint64 now = m_elapsed.nsecsElapsed();
+  float dt = (now - m_lastNs) / 1e9f;
+  m_lastNs = now;
+  Profiler::frameTick(dt);
+  ProfileScope scope("frame.update");
+  FrameCostScope cost;
+  dt = std::min(dt, kMaxFrameSeconds);
+  // By index: a step may register further sources
+  for (int i = 0; i < m_sources.size(); ++i) {
+    const Source &source = m_sources[i];
+    if (source.step && isOnScreen(source.widget))
+      source.step(dt);
+  }
+  emit frame(dt);
+
+  // Next refresh in phase with the previous ones; a frame that overran
+  // drops the periods it missed instead of rushing to catch up
+  m_deadlineNs += m_periodNs;
+  qint64 after = m_elapsed.nsecsElapsed();
+  if (m_deadlineNs <= after)
+    m_deadlineNs += ((after - m_deadlineNs) / m_periodNs + 1) * m_periodNs;
+  reschedule();
+  if (m_running)
+    scheduleNext();
+}
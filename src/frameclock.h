@@ -0,0 +1,90 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QScreen>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class QWidget;
+
+// Single animation clock shared by every overlay window. It wakes once per
+// display refresh (following the primary screen's refresh rate) and emits
+// frame() with the elapsed time, so all motion is time-based and the windows
+// advance in lockstep instead of drifting on separate timers. Wakeups are
+// aimed at exact nanosecond deadlines one period apart, so millisecond timer
+// rounding never adds up to a skipped refresh.
+//
+// The clock only runs while some registered source has live animation in an
+// exposed window. It stops when everything is idle, occluded or the
+// application is suspended, and caps itself at 30 Hz on battery power.
+class FrameClock : public QObject {
+  Q_OBJECT
+public:
+  static FrameClock *instance();
+
+  // Seconds since the clock started; monotonic.
+  double time() const;
+
+  // Registers a subsystem drawn in `widget`. isAnimating is polled after
+  // every frame and on wake(), so it must be cheap. A source given `step`
+  // is advanced through it only while its widget is visible and exposed;
+  // hidden or covered ones freeze while the clock runs for the others.
+  void registerSource(QWidget *widget, std::function<bool()> isAnimating,
+                      std::function<void(float)> step = {});
+  // Re-evaluates the sources after a state change that may start animation
+  void wake();
+
+  // Upper bound on the frame rate, on top of the display and battery
+  // limits; 0 removes it
+  void setFrameRateCap(int hz);
+
+  bool isRunning() const { return m_running; }
+  bool isOnBattery() const { return m_onBattery; }
+  // Timer wakeups (frames plus power polls) during the last second
+  double wakeupsPerSecond();
+
+signals:
+  void frame(float dt);
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+  struct Source {
+    QPointer<QWidget> widget;
+    std::function<bool()> isAnimating;
+    std::function<void(float)> step;
+  };
+
+  static bool isOnScreen(const QWidget *widget);
+
+  explicit FrameClock(QObject *parent = nullptr);
+  void tick();
+  void reschedule();
+  void applyInterval();
+  void scheduleNext();
+  void trackScreen(QScreen *screen);
+  void pollPowerSource();
+  void recordWakeup();
+
+  QTimer m_timer;
+  QTimer m_powerTimer;
+  QElapsedTimer m_elapsed;
+  qint64 m_lastNs = 0;
+  qint64 m_periodNs = 0;   // Frame period after display, battery and cap
+  qint64 m_deadlineNs = 0; // When the next frame is due
+  bool m_running = false;
+  QPointer<QScreen> m_screen;
+  QVector<Source> m_sources;
+  bool m_suspended = false;
+  bool m_onBattery = false;
+  int m_frameRateCap = 0;
+  QQueue<qint64> m_wakeups;
+};
+
+#endif // FRAMECLOCK_H
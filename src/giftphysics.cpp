@@ -0,0 +1,559 @@
+#include "giftphysics.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+constexpr float kGravity = 900.0f;       // px/s^2
+constexpr float kSubstep = 1.0f / 120.0f; // s
+constexpr int kMaxSubsteps = 8;          // time beyond this is dropped
+constexpr int kIterations = 10;
+constexpr float kFriction = 0.5f;
+constexpr float kBiasFactor = 0.2f; // share of penetration fixed per substep
+constexpr float kSlop = 0.5f;       // px of penetration left alone
+
+constexpr float kSleepLinear = 6.0f;  // px/s
+constexpr float kSleepAngular = 0.1f; // rad/s
+constexpr float kSleepDelay = 0.5f;   // s at rest before sleeping
+constexpr float kWakeSpeed = 120.0f;  // px/s impact that wakes a sleeper
+constexpr float kLandSpeed = 150.0f;  // px/s fall that counts as landing
+
+// Literals: M_PI and M_SQRT2 are not standard C++
+constexpr float kDegrees = 57.2957795f;
+constexpr float kSqrt2 = 1.41421356f;
+
+// Sleeper grid; cells are hashed, so piles may grow past any edge
+constexpr float kCellSize = 64.0f; // px, about two medium boxes
+
+// Out-of-order additions to the awake list past which it is fully sorted
+constexpr int kInsertionSortLimit = 32;
+
+struct Vec {
+  float x, y;
+};
+
+inline float dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+
+// Half width of a square's shadow on `axis`; (c, s) is its rotation
+inline float projectedRadius(float half, float c, float s, Vec axis) {
+  return half * (std::fabs(c * axis.x + s * axis.y) +
+                 std::fabs(-s * axis.x + c * axis.y));
+}
+
+struct CellRange {
+  int x0, y0, x1, y1; // inclusive
+};
+
+CellRange cellRange(float x0, float y0, float x1, float y1) {
+  auto cell = [](float v) { return int(std::floor(v / kCellSize)); };
+  return {cell(x0), cell(y0), cell(x1), cell(y1)};
+}
+
+quint64 cellKey(int x, int y) {
+  return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+// Keeps the part of segment [p[0], p[1]] with dot(n, p) <= offset
+int clipSegment(Vec p[2], Vec n, float offset) {
+  float d0 = dot(n, p[0]) - offset;
+  float d1 = dot(n, p[1]) - offset;
+  if (d0 > 0 && d1 > 0)
+    return 0;
+  if (d0 > 0 || d1 > 0) {
+    float t = d0 / (d0 - d1);
+    Vec cut = {p[0].x + t * (p[1].x - p[0].x), p[0].y + t * (p[1].y - p[0].y)};
+    p[d0 > 0 ? 0 : 1] = cut;
+  }
+  return 2;
+}
+} // namespace
+
+void GiftPhysics::setBounds(float left, float right, float floor) {
+  m_left = left;
+  m_right = right;
+  m_floor = floor;
+  for (int i = 0; i < m_bodies.size(); ++i)
+    wake(i);
+}
+
+void GiftPhysics::append(const QPointF &center, float half, float angle,
+                         bool asleep) {
+  Body body;
+  body.x = center.x();
+  body.y = center.y();
+  body.angle = angle / kDegrees;
+  body.half = half;
+  // Unit density; a square's inertia is m * side^2 / 6
+  float mass = 4.0f * half * half;
+  body.invMass = 1.0f / mass;
+  body.invInertia = 6.0f / (mass * 4.0f * half * half);
+
+  const int index = m_bodies.size();
+  m_bodies.append(body);
+  m_bounds.append({});
+  if (asleep) {
+    sleep(index);
+  } else {
+    m_active.append(index); // bounds are refreshed by the next substep
+    ++m_unsorted;
+  }
+}
+
+void GiftPhysics::removeAt(int index) {
+  const Body removed = m_bodies[index];
+  if (removed.asleep)
+    removeSleeper(index);
+  else
+    m_active.removeOne(index);
+
+  for (int i : std::as_const(m_moved))
+    m_bodies[i].moved = false;
+  m_moved.clear();
+  m_landed.clear();
+
+  m_warmStart.clear(); // keys hold indices
+  m_bodies.removeAt(index);
+  m_bounds.removeAt(index);
+  for (int &i : m_active) {
+    if (i > index)
+      --i;
+  }
+  for (QVector<int> &cell : m_sleepers) {
+    for (int &i : cell) {
+      if (i > index)
+        --i;
+    }
+  }
+
+  // Whatever may have rested on it has to fall again
+  float reach = 2.0f * removed.half * kSqrt2;
+  for (int i = 0; i < m_bodies.size(); ++i) {
+    const Body &body = m_bodies[i];
+    if (std::fabs(body.x - removed.x) < reach + body.half * kSqrt2 &&
+        body.y < removed.y + reach)
+      wake(i);
+  }
+}
+
+void GiftPhysics::clear() {
+  m_bodies.clear();
+  m_bounds.clear();
+  m_active.clear();
+  m_sleepers.clear();
+  m_pendingWake.clear();
+  m_unsorted = 0;
+  m_contacts.clear();
+  m_warmStart.clear();
+  m_moved.clear();
+  m_landed.clear();
+  m_accumulator = 0;
+}
+
+QPointF GiftPhysics::position(int index) const {
+  return QPointF(m_bodies[index].x, m_bodies[index].y);
+}
+
+float GiftPhysics::angle(int index) const {
+  return m_bodies[index].angle * kDegrees;
+}
+
+void GiftPhysics::step(float dt) {
+  for (int i : std::as_const(m_moved))
+    m_bodies[i].moved = false;
+  m_moved.clear();
+  m_landed.clear();
+
+  if (m_active.isEmpty()) {
+    m_accumulator = 0;
+    return;
+  }
+
+  for (int i : std::as_const(m_active)) {
+    markMoved(i);
+    m_bodies[i].stepVy = m_bodies[i].vy;
+  }
+
+  m_accumulator += dt;
+  int steps = 0;
+  while (m_accumulator >= kSubstep && !m_active.isEmpty()) {
+    if (steps++ == kMaxSubsteps) {
+      m_accumulator = 0;
+      break;
+    }
+    substep(kSubstep);
+    m_accumulator -= kSubstep;
+  }
+
+  // A fast fall that lost most of its speed hit the floor or a box
+  for (int i : std::as_const(m_moved)) {
+    const Body &body = m_bodies[i];
+    if (body.stepVy > kLandSpeed && body.vy < body.stepVy * 0.5f)
+      m_landed.append(i);
+  }
+}
+
+void GiftPhysics::substep(float h) {
+  for (int i : std::as_const(m_active))
+    m_bodies[i].vy += kGravity * h;
+
+  findContacts();
+
+  auto invMass = [this](int i) {
+    return i < 0 || m_bodies[i].asleep ? 0.0f : m_bodies[i].invMass;
+  };
+  auto invInertia = [this](int i) {
+    return i < 0 || m_bodies[i].asleep ? 0.0f : m_bodies[i].invInertia;
+  };
+
+  for (Contact &c : m_contacts) {
+    const Body &a = m_bodies[c.a];
+    float rax = c.px - a.x, ray = c.py - a.y;
+    float rbx = 0, rby = 0;
+    if (c.b >= 0) {
+      rbx = c.px - m_bodies[c.b].x;
+      rby = c.py - m_bodies[c.b].y;
+    }
+    float tx = -c.ny, ty = c.nx;
+    float rnA = rax * c.ny - ray * c.nx, rnB = rbx * c.ny - rby * c.nx;
+    float rtA = rax * ty - ray * tx, rtB = rbx * ty - rby * tx;
+    float massSum = invMass(c.a) + invMass(c.b);
+    float kn = massSum + invInertia(c.a) * rnA * rnA +
+               invInertia(c.b) * rnB * rnB;
+    float kt = massSum + invInertia(c.a) * rtA * rtA +
+               invInertia(c.b) * rtB * rtB;
+    c.massN = kn > 0 ? 1.0f / kn : 0.0f;
+    c.massT = kt > 0 ? 1.0f / kt : 0.0f;
+    c.bias = kBiasFactor / h * std::max(0.0f, c.depth - kSlop);
+
+    Impulse cached = m_warmStart.value(contactKey(c), Impulse{0, 0});
+    c.impulseN = cached.normal;
+    c.impulseT = cached.tangent;
+  }
+
+  Body ground{}; // stands in for the floor and walls; never integrated
+  auto applyImpulse = [&](const Contact &c, float px, float py) {
+    Body &a = m_bodies[c.a];
+    Body &b = c.b >= 0 ? m_bodies[c.b] : ground;
+    float imA = invMass(c.a), iiA = invInertia(c.a);
+    float imB = invMass(c.b), iiB = invInertia(c.b);
+    float rax = c.px - a.x, ray = c.py - a.y;
+    float rbx = c.b >= 0 ? c.px - b.x : 0, rby = c.b >= 0 ? c.py - b.y : 0;
+    a.vx -= imA * px;
+    a.vy -= imA * py;
+    a.w -= iiA * (rax * py - ray * px);
+    b.vx += imB * px;
+    b.vy += imB * py;
+    b.w += iiB * (rbx * py - rby * px);
+  };
+
+  for (const Contact &c : std::as_const(m_contacts)) {
+    applyImpulse(c, c.impulseN * c.nx - c.impulseT * c.ny,
+                 c.impulseN * c.ny + c.impulseT * c.nx);
+  }
+
+  for (int iteration = 0; iteration < kIterations; ++iteration) {
+    for (Contact &c : m_contacts) {
+      Body &a = m_bodies[c.a];
+      Body &b = c.b >= 0 ? m_bodies[c.b] : ground;
+      float rax = c.px - a.x, ray = c.py - a.y;
+      float rbx = c.b >= 0 ? c.px - b.x : 0, rby = c.b >= 0 ? c.py - b.y : 0;
+
+      auto apply = [&](float px, float py) { applyImpulse(c, px, py); };
+      auto relative = [&](float &dvx, float &dvy) {
+        dvx = (b.vx - b.w * rby) - (a.vx - a.w * ray);
+        dvy = (b.vy + b.w * rbx) - (a.vy + a.w * rax);
+      };
+
+      float dvx, dvy;
+      relative(dvx, dvy);
+      float vn = dvx * c.nx + dvy * c.ny;
+      float old = c.impulseN;
+      c.impulseN = std::max(old + c.massN * (c.bias - vn), 0.0f);
+      float dn = c.impulseN - old;
+      apply(dn * c.nx, dn * c.ny);
+
+      relative(dvx, dvy);
+      float tx = -c.ny, ty = c.nx;
+      float vt = dvx * tx + dvy * ty;
+      float limit = kFriction * c.impulseN;
+      old = c.impulseT;
+      c.impulseT = std::clamp(old - c.massT * vt, -limit, limit);
+      float dtangent = c.impulseT - old;
+      apply(dtangent * tx, dtangent * ty);
+    }
+  }
+
+  m_warmStart.clear();
+  for (const Contact &c : std::as_const(m_contacts))
+    m_warmStart.insert(contactKey(c), {c.impulseN, c.impulseT});
+
+  for (int i : std::as_const(m_active)) {
+    Body &body = m_bodies[i];
+    body.x += body.vx * h;
+    body.y += body.vy * h;
+    body.angle += body.w * h;
+  }
+
+  updateSleep(h);
+}
+
+void GiftPhysics::findContacts() {
+  m_contacts.clear();
+
+  for (int i : std::as_const(m_active))
+    refreshBounds(i);
+
+  auto higher = [this](int a, int b) {
+    return m_bounds[a].y0 < m_bounds[b].y0;
+  };
+  if (m_unsorted > kInsertionSortLimit) {
+    // A bulk append or wake is in arbitrary order
+    std::sort(m_active.begin(), m_active.end(), higher);
+  } else {
+    // Insertion sort: bodies barely move between substeps, so this is
+    // linear
+    for (int k = 1; k < m_active.size(); ++k) {
+      int index = m_active[k];
+      int j = k - 1;
+      for (; j >= 0 && higher(index, m_active[j]); --j)
+        m_active[j + 1] = m_active[j];
+      m_active[j + 1] = index;
+    }
+  }
+  m_unsorted = 0;
+
+  for (int k = 0; k < m_active.size(); ++k) {
+    const int i = m_active[k];
+    const Bounds &a = m_bounds[i];
+    collideBounds(i);
+
+    // Awake pairs: sweep down the sorted list until tops pass our bottom
+    for (int l = k + 1; l < m_active.size(); ++l) {
+      const int j = m_active[l];
+      const Bounds &b = m_bounds[j];
+      if (b.y0 > a.y1)
+        break;
+      if (b.x0 <= a.x1 && a.x0 <= b.x1)
+        collideBoxes(i, j);
+    }
+
+    // Sleepers in the cells we cover; the stamp skips boxes met in an
+    // earlier cell
+    const quint32 visit = ++m_visit;
+    const CellRange range = cellRange(a.x0, a.y0, a.x1, a.y1);
+    for (int y = range.y0; y <= range.y1; ++y) {
+      for (int x = range.x0; x <= range.x1; ++x) {
+        auto cell = m_sleepers.constFind(cellKey(x, y));
+        if (cell == m_sleepers.constEnd())
+          continue;
+        for (int j : *cell) {
+          Body &sleeper = m_bodies[j];
+          if (sleeper.visit == visit)
+            continue;
+          sleeper.visit = visit;
+          const Bounds &b = m_bounds[j];
+          if (b.x0 <= a.x1 && a.x0 <= b.x1 && b.y0 <= a.y1 && a.y0 <= b.y1)
+            collideBoxes(i, j);
+        }
+      }
+    }
+  }
+
+  // Deferred so the list and the grid stay put while they are walked; the
+  // woken boxes still join this substep's solve and integration
+  for (int i : std::as_const(m_pendingWake))
+    wake(i);
+  m_pendingWake.clear();
+}
+
+void GiftPhysics::refreshBounds(int index) {
+  const Body &body = m_bodies[index];
+  float extent = body.half * (std::fabs(std::cos(body.angle)) +
+                              std::fabs(std::sin(body.angle)));
+  m_bounds[index] = {body.x - extent, body.y - extent, body.x + extent,
+                     body.y + extent};
+}
+
+void GiftPhysics::addSleeper(int index) {
+  const Bounds &b = m_bounds[index];
+  const CellRange range = cellRange(b.x0, b.y0, b.x1, b.y1);
+  for (int y = range.y0; y <= range.y1; ++y) {
+    for (int x = range.x0; x <= range.x1; ++x)
+      m_sleepers[cellKey(x, y)].append(index);
+  }
+}
+
+void GiftPhysics::removeSleeper(int index) {
+  // Bounds are frozen while asleep, so they name the same cells
+  const Bounds &b = m_bounds[index];
+  const CellRange range = cellRange(b.x0, b.y0, b.x1, b.y1);
+  for (int y = range.y0; y <= range.y1; ++y) {
+    for (int x = range.x0; x <= range.x1; ++x) {
+      auto cell = m_sleepers.find(cellKey(x, y));
+      if (cell == m_sleepers.end())
+        continue;
+      cell->removeOne(index);
+      if (cell->isEmpty())
+        m_sleepers.erase(cell);
+    }
+  }
+}
+
+void GiftPhysics::collideBounds(int index) {
+  const Body &body = m_bodies[index];
+  float c = std::cos(body.angle), s = std::sin(body.angle);
+  const float corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (int k = 0; k < 4; ++k) {
+    float ox = body.half * corners[k][0], oy = body.half * corners[k][1];
+    float px = body.x + ox * c - oy * s;
+    float py = body.y + ox * s + oy * c;
+    if (py > m_floor)
+      addContact(index, -1, k, 0, 1, px, py, py - m_floor);
+    if (px < m_left)
+      addContact(index, -1, 4 + k, -1, 0, px, py, m_left - px);
+    if (px > m_right)
+      addContact(index, -1, 8 + k, 1, 0, px, py, px - m_right);
+  }
+}
+
+void GiftPhysics::collideBoxes(int ia, int ib) {
+  const Body &a = m_bodies[ia];
+  const Body &b = m_bodies[ib];
+  float ca = std::cos(a.angle), sa = std::sin(a.angle);
+  float cb = std::cos(b.angle), sb = std::sin(b.angle);
+  const Vec axes[4] = {{ca, sa}, {-sa, ca}, {cb, sb}, {-sb, cb}};
+  Vec delta = {b.x - a.x, b.y - a.y};
+
+  // Separating axis test; A's faces win near-ties so the reference face
+  // does not flip between substeps
+  int best = -1;
+  float bestOverlap = 0, bestSign = 1;
+  for (int k = 0; k < 4; ++k) {
+    float d = dot(delta, axes[k]);
+    float overlap = projectedRadius(a.half, ca, sa, axes[k]) +
+                    projectedRadius(b.half, cb, sb, axes[k]) - std::fabs(d);
+    if (overlap < 0)
+      return;
+    float tolerance = k < 2 ? 0 : 0.05f * bestOverlap + 0.01f * b.half;
+    if (best < 0 || overlap < bestOverlap - tolerance) {
+      best = k;
+      bestOverlap = overlap;
+      bestSign = d < 0 ? -1.0f : 1.0f;
+    }
+  }
+
+  // Reference face on the box owning the axis, facing the other box
+  const bool referenceIsA = best < 2;
+  const Body &ref = referenceIsA ? a : b;
+  const Body &inc = referenceIsA ? b : a;
+  float refSign = referenceIsA ? bestSign : -bestSign;
+  Vec n = {axes[best].x * refSign, axes[best].y * refSign};
+  Vec t = {-n.y, n.x};
+
+  // Incident face: the other box's face most opposed to n
+  float ci = referenceIsA ? cb : ca, si = referenceIsA ? sb : sa;
+  const Vec faces[4] = {{ci, si}, {-si, ci}, {-ci, -si}, {si, -ci}};
+  Vec incN = faces[0];
+  for (const Vec &face : faces) {
+    if (dot(face, n) < dot(incN, n))
+      incN = face;
+  }
+  Vec incT = {-incN.y, incN.x};
+  Vec mid = {inc.x + incN.x * inc.half, inc.y + incN.y * inc.half};
+  Vec points[2] = {{mid.x + incT.x * inc.half, mid.y + incT.y * inc.half},
+                   {mid.x - incT.x * inc.half, mid.y - incT.y * inc.half}};
+
+  float centre = dot(t, {ref.x, ref.y});
+  if (!clipSegment(points, t, centre + ref.half) ||
+      !clipSegment(points, {-t.x, -t.y}, -centre + ref.half))
+    return;
+
+  Vec normal = referenceIsA ? n : Vec{-n.x, -n.y};
+  for (int k = 0; k < 2; ++k) {
+    const Vec &p = points[k];
+    float separation = dot(n, {p.x - ref.x, p.y - ref.y}) - ref.half;
+    if (separation <= 0)
+      addContact(ia, ib, best * 2 + k, normal.x, normal.y, p.x, p.y,
+                 -separation);
+  }
+}
+
+void GiftPhysics::addContact(int a, int b, int feature, float nx, float ny,
+                             float px, float py, float depth) {
+  if (b >= 0 && m_bodies[a].asleep != m_bodies[b].asleep) {
+    // A hard hit wakes the sleeper; a gentle touch just rests on it
+    const Body &ba = m_bodies[a];
+    const Body &bb = m_bodies[b];
+    float closing = (ba.vx - bb.vx) * nx + (ba.vy - bb.vy) * ny;
+    if (closing > kWakeSpeed)
+      m_pendingWake.append(ba.asleep ? a : b);
+  }
+  if (m_bodies[a].asleep) {
+    // Keep the awake body first; floor contacts always have one
+    std::swap(a, b);
+    nx = -nx;
+    ny = -ny;
+  }
+
+  Contact contact;
+  contact.a = a;
+  contact.b = b;
+  contact.feature = feature;
+  contact.nx = nx;
+  contact.ny = ny;
+  contact.px = px;
+  contact.py = py;
+  contact.depth = depth;
+  m_contacts.append(contact);
+}
+
+quint64 GiftPhysics::contactKey(const Contact &contact) {
+  return (quint64(quint32(contact.a)) << 36) ^
+         (quint64(quint32(contact.b + 1)) << 8) ^ quint64(contact.feature);
+}
+
+void GiftPhysics::wake(int index) {
+  Body &body = m_bodies[index];
+  if (!body.asleep)
+    return;
+  body.asleep = false;
+  body.restTime = 0;
+  removeSleeper(index);
+  m_active.append(index);
+  ++m_unsorted;
+  markMoved(index);
+}
+
+void GiftPhysics::sleep(int index) {
+  Body &body = m_bodies[index];
+  body.asleep = true;
+  body.vx = body.vy = body.w = 0;
+  refreshBounds(index); // Frozen from here on
+  addSleeper(index);
+}
+
+void GiftPhysics::markMoved(int index) {
+  Body &body = m_bodies[index];
+  if (body.moved)
+    return;
+  body.moved = true;
+  m_moved.append(index);
+}
+
+void GiftPhysics::updateSleep(float h) {
+  // Sleepers leave the active list in place, which keeps it sorted
+  int kept = 0;
+  for (int k = 0, n = m_active.size(); k < n; ++k) {
+    const int i = m_active[k];
+    Body &body = m_bodies[i];
+    bool resting = body.vx * body.vx + body.vy * body.vy <
+                       kSleepLinear * kSleepLinear &&
+                   std::fabs(body.w) < kSleepAngular;
+    body.restTime = resting ? body.restTime + h : 0;
+    if (body.restTime > kSleepDelay)
+      sleep(i);
+    else
+      m_active[kept++] = i;
+  }
+  m_active.resize(kept);
+}
@@ -0,0 +1,105 @@
+#ifndef GIFTPHYSICS_H
+#define GIFTPHYSICS_H
+
+#include <QHash>
+#include <QPointF>
+#include <QVector>
+
+// Small 2D rigid-body stage for gift boxes: gravity, oriented box contacts
+// against the floor, the side walls and each other, solved with sequential
+// impulses at a fixed 120 Hz substep, warm started from the previous
+// substep's impulses so stacks stay still. Bodies that come to rest fall
+// asleep and act as static ground for the awake ones: their bounds are
+// frozen into a uniform grid, and every per-substep loop (integration,
+// bounds, pair search) walks only the awake bodies. Awake pairs come from a
+// sweep-and-prune over y, awake-sleeper pairs from the grid cells around
+// each awake body, so a settled pile costs nothing and the owner can stop
+// ticking once awakeCount() is 0.
+//
+// Bodies are identified by index, parallel to the owner's gift list.
+class GiftPhysics {
+public:
+  // Floor and wall lines the boxes rest against, in widget coordinates
+  void setBounds(float left, float right, float floor);
+
+  // Appends a square box (`half` is half its side, angle in degrees). An
+  // asleep box goes straight into the grid as resting ground, which is how
+  // a saved pile is restored without being simulated again.
+  void append(const QPointF &center, float half, float angle,
+              bool asleep = false);
+  void removeAt(int index);
+  void clear();
+
+  // Advances by dt seconds. Bodies that moved are listed in moved().
+  void step(float dt);
+  const QVector<int> &moved() const { return m_moved; }
+  // Bodies whose fall was stopped by an impact during the last step
+  const QVector<int> &landed() const { return m_landed; }
+
+  int size() const { return m_bodies.size(); }
+  int awakeCount() const { return m_active.size(); }
+  bool isAsleep(int index) const { return m_bodies[index].asleep; }
+  QPointF position(int index) const;
+  float angle(int index) const; // degrees
+
+private:
+  struct Body {
+    float x, y, angle; // centre and rotation (radians)
+    float vx = 0, vy = 0, w = 0;
+    float half;
+    float invMass, invInertia;
+    float restTime = 0; // seconds spent below the sleep thresholds
+    float stepVy = 0;   // vy when the current step began
+    bool asleep = false;
+    bool moved = false; // already listed in m_moved this step
+    quint32 visit = 0;  // last grid query that reported it
+  };
+
+  struct Bounds {
+    float x0, y0, x1, y1;
+  };
+
+  struct Contact {
+    int a, b;      // b == -1 for floor and walls
+    int feature;   // which corner or clip point, stable across substeps
+    float nx, ny;  // unit normal pointing from a towards b
+    float px, py;  // world contact point
+    float depth;
+    float massN, massT, bias;
+    float impulseN = 0, impulseT = 0;
+  };
+
+  void substep(float h);
+  void findContacts();
+  void refreshBounds(int index);
+  void addSleeper(int index);
+  void removeSleeper(int index);
+  void collideBounds(int index);
+  void collideBoxes(int a, int b);
+  void addContact(int a, int b, int feature, float nx, float ny, float px,
+                  float py, float depth);
+  static quint64 contactKey(const Contact &contact);
+  void wake(int index);
+  void sleep(int index);
+  void markMoved(int index);
+  void updateSleep(float h);
+
+  QVector<Body> m_bodies;
+  QVector<Bounds> m_bounds; // per body; frozen while it sleeps
+  QVector<int> m_active;    // awake bodies, kept sorted by bounds top
+  int m_unsorted = 0;       // appended to m_active since the last sort
+  QHash<quint64, QVector<int>> m_sleepers; // sleeping bodies by grid cell
+  QVector<int> m_pendingWake; // sleepers hit hard while finding contacts
+  quint32 m_visit = 0;
+  QVector<Contact> m_contacts;
+  struct Impulse {
+    float normal, tangent;
+  };
+  QHash<quint64, Impulse> m_warmStart; // last substep's impulses by contact
+  QVector<int> m_moved;
+  QVector<int> m_landed;
+  float m_left = 0, m_right = 400, m_floor = 465;
+  float m_accumulator = 0;
+};
+
+#endif // GIFTPHYSICS_H
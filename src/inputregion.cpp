@@ -0,0 +1,54 @@
+#include "inputregion.h"
+#include <QGuiApplication>
+#include <QVector>
+#include <QWidget>
+#include <QWindow>
+#include <QtMath>
+
+#if defined(CHRISTMAS_OVERLAY_XCB_SHAPE) && QT_CONFIG(xcb)
+#define HAVE_XCB_INPUT_SHAPE
+#include <xcb/shape.h>
+#include <xcb/xcb.h>
+#endif
+
+bool setInputRegion(QWidget *window, const QRegion &region) {
+  QWindow *handle = window->windowHandle();
+  if (!handle)
+    return false;
+  const QString platform = QGuiApplication::platformName();
+
+  if (platform.startsWith("wayland")) {
+    // QtWayland turns a window mask into the input region only
+    handle->setMask(region);
+    return true;
+  }
+
+#ifdef HAVE_XCB_INPUT_SHAPE
+  if (platform == "xcb") {
+    // QWindow::setMask sets the bounding shape here, which clips drawing
+    auto *x11 = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
+    if (!x11)
+      return false;
+    const qreal dpr = handle->devicePixelRatio();
+    QVector<xcb_rectangle_t> rects;
+    for (const QRect &rect : region) {
+      const QRect device(QPoint(qFloor(rect.left() * dpr),
+                                qFloor(rect.top() * dpr)),
+                         QPoint(qCeil((rect.right() + 1) * dpr) - 1,
+                                qCeil((rect.bottom() + 1) * dpr) - 1));
+      rects.append({static_cast<int16_t>(device.x()),
+                    static_cast<int16_t>(device.y()),
+                    static_cast<uint16_t>(device.width()),
+                    static_cast<uint16_t>(device.height())});
+    }
+    xcb_shape_rectangles(x11->connection(), XCB_SHAPE_SO_SET,
+                         XCB_SHAPE_SK_INPUT, XCB_CLIP_ORDERING_UNSORTED,
+                         static_cast<xcb_window_t>(handle->winId()), 0, 0,
+                         rects.size(), rects.constData());
+    xcb_flush(x11->connection());
+    return true;
+  }
+#endif
+
+  return false;
+}
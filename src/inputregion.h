@@ -0,0 +1,15 @@
+#ifndef INPUTREGION_H
+#define INPUTREGION_H
+
+#include <QRegion>
+
+class QWidget;
+
+// Limits where the top-level `window` takes pointer input to `region`
+// (window coordinates) without clipping what it draws: the surface input
+// region on Wayland, the X Shape input shape on X11. Returns false where no
+// such shape exists; Windows layered windows and non-opaque macOS windows
+// instead hit-test per pixel and pass clicks through alpha-0 pixels.
+bool setInputRegion(QWidget *window, const QRegion &region);
+
+#endif // INPUTREGION_H
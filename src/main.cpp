@@ -1,16 +1,84 @@
+#include "desktopsnow.h"
+#include "frameclock.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include "rng.h"
+#include "sceneautosave.h"
+#include "scenefile.h"
+#include "scenewindow.h"
 #include "snowoverlay.h"
 #include "treewidget.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
 #include <QScreen>
+#include <QTimer>
 
 int main(int argc, char *argv[]) {
   QApplication a(argc, argv);
 
-  TreeWidget *tree = new TreeWidget();
-  SnowOverlay *backSnow = new SnowOverlay(false);
-  SnowOverlay *frontSnow = new SnowOverlay(true);
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  QCommandLineOption snowRendererOption(
+      "snow-renderer", "Snow rendering backend: painter or splat.", "backend",
+      "painter");
+  parser.addOption(snowRendererOption);
+  QCommandLineOption wakeupStatsOption(
+      "wakeup-stats", "Log animation wakeups per second every 10 seconds.");
+  parser.addOption(wakeupStatsOption);
+  QCommandLineOption desktopSnowOption(
+      "desktop-snow", "Let it snow over every screen, not just the tree.");
+  parser.addOption(desktopSnowOption);
+  QCommandLineOption singleWindowOption(
+      "single-window",
+      "Composite snow and tree in one window instead of three stacked ones.");
+  parser.addOption(singleWindowOption);
+  QCommandLineOption seedOption(
+      "seed", "Seed for all random generators, for reproducible runs.",
+      "number");
+  parser.addOption(seedOption);
+  QCommandLineOption sceneOption(
+      "scene", "Load and autosave the decorated scene at <file>.", "file",
+      SceneFile::defaultPath());
+  parser.addOption(sceneOption);
+  QCommandLineOption traceOption(
+      "trace", "Profile and write a Chrome trace to <file> on exit.", "file");
+  parser.addOption(traceOption);
+  QCommandLineOption frameBudgetOption(
+      "frame-budget",
+      "Milliseconds of work per frame before quality is reduced (0: never).",
+      "ms", "8");
+  parser.addOption(frameBudgetOption);
+  parser.process(a);
 
-  tree->setSnowLayers(backSnow, frontSnow);
+  bool budgetOk = false;
+  double frameBudget = parser.value(frameBudgetOption).toDouble(&budgetOk);
+  if (!budgetOk || frameBudget < 0)
+    parser.showHelp(1);
+  QualityGovernor::instance()->setBudget(frameBudget);
+
+  if (parser.isSet(traceOption)) {
+    Profiler::setEnabled(true);
+    QString tracePath = parser.value(traceOption);
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, [tracePath] {
+      QString error;
+      if (!Profiler::writeTrace(tracePath, &error))
+        qWarning("Cannot write trace %s: %s", qPrintable(tracePath),
+                 qPrintable(error));
+    });
+  }
+
+  if (parser.isSet(seedOption)) {
+    bool ok = false;
+    quint64 seed = parser.value(seedOption).toULongLong(&ok);
+    if (!ok)
+      parser.showHelp(1);
+    Rng::setSeed(seed);
+  }
+
+  const SnowRenderBackend backend =
+      parser.value(snowRendererOption) == "splat" ? SnowRenderBackend::Splat
+                                                  : SnowRenderBackend::Painter;
 
   QScreen *screen = QApplication::primaryScreen();
   QRect screenGeometry = screen->availableGeometry();
@@ -19,17 +87,75 @@ int main(int argc, char *argv[]) {
   int x = screenGeometry.left() + (screenGeometry.width() - 400) / 2;
   int y = screenGeometry.top() + (screenGeometry.height() - 500) / 2;
 
-  tree->move(x, y);
-  backSnow->move(x, 0);  // Start at top, align horizontally
-  frontSnow->move(x, 0); // Start at top, align horizontally
+  const bool desktopSnow = parser.isSet(desktopSnowOption);
+  const bool singleWindow = parser.isSet(singleWindowOption) && !desktopSnow;
+  if (parser.isSet(singleWindowOption) && desktopSnow)
+    qWarning("--single-window is ignored with --desktop-snow");
+
+  TreeWidget *tree = nullptr;
+  if (singleWindow) {
+    auto *scene = new SceneWindow();
+    tree = scene->tree();
+    scene->backSnow()->setRenderBackend(backend);
+    scene->frontSnow()->setRenderBackend(backend);
+    scene->placeTree(QPoint(x, y));
+    scene->show();
+  } else if (desktopSnow) {
+    tree = new TreeWidget();
+    tree->move(x, y);
+
+    auto *snow = new DesktopSnow(&a);
+    snow->setRenderBackend(backend);
+    tree->setDesktopSnow(snow);
+
+    snow->showBack();
+    tree->show();
+    snow->showFront();
+
+    // Same macOS stacking workaround as the column layers below
+    QTimer::singleShot(100, [snow]() { snow->raiseFront(); });
+  } else {
+    tree = new TreeWidget();
+    SnowOverlay *backSnow = new SnowOverlay(false);
+    SnowOverlay *frontSnow = new SnowOverlay(true);
+    backSnow->setRenderBackend(backend);
+    frontSnow->setRenderBackend(backend);
+    tree->setSnowLayers(backSnow, frontSnow);
+
+    tree->move(x, y);
+    backSnow->move(x, 0);  // Start at top, align horizontally
+    frontSnow->move(x, 0); // Start at top, align horizontally
+
+    backSnow->show();
+    tree->show();
+    frontSnow->show();
+
+    // Enforce front snow on top of the tree with a small delay to handle
+    // macOS window manager
+    QTimer::singleShot(100, [frontSnow]() { frontSnow->raise(); });
+  }
 
-  backSnow->show();
-  tree->show();
-  frontSnow->show();
+  // Restore the last session before the first frame, then keep it saved
+  const QString scenePath = parser.value(sceneOption);
+  SceneData saved;
+  QString sceneError;
+  if (SceneFile::load(scenePath, saved, &sceneError))
+    tree->loadScene(saved);
+  else if (QFile::exists(scenePath))
+    qWarning("Cannot load scene %s: %s", qPrintable(scenePath),
+             qPrintable(sceneError));
+  new SceneAutosave(tree, scenePath, &a);
 
-  // Enforce front snow on top of the tree with a small delay to handle macOS
-  // window manager
-  QTimer::singleShot(100, [frontSnow]() { frontSnow->raise(); });
+  if (parser.isSet(wakeupStatsOption)) {
+    auto *statsTimer = new QTimer(&a);
+    QObject::connect(statsTimer, &QTimer::timeout, [] {
+      FrameClock *clock = FrameClock::instance();
+      qInfo("wakeups/s: %.0f (%s%s)", clock->wakeupsPerSecond(),
+            clock->isRunning() ? "animating" : "idle",
+            clock->isOnBattery() ? ", battery" : "");
+    });
+    statsTimer->start(10000);
+  }
 
   return a.exec();
 }
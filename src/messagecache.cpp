@@ -0,0 +1,114 @@
+#include "messagecache.h"
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Messages pulse within +-3%; 0.005 steps keep the garland sub-pixel exact
+// with at most a dozen layouts per message.
+constexpr float kScaleStep = 0.005f;
+
+// Card rect is (-10, -12, 20, 24) with a 2px pen, so a 1px margin covers it
+constexpr int kCardWidth = 22;
+constexpr int kCardHeight = 26;
+} // namespace
+
+const GarlandLayout &MessageRenderCache::layout(const QString &text,
+                                                float scale) {
+  if (text != m_text) {
+    m_layouts.clear();
+    m_text = text;
+  }
+
+  int step = static_cast<int>(std::lround(scale / kScaleStep));
+  auto it = m_layouts.find(step);
+  if (it == m_layouts.end())
+    it = m_layouts.insert(step, build(text, step * kScaleStep));
+  return *it;
+}
+
+GarlandLayout MessageRenderCache::build(const QString &text, float scale) {
+  GarlandLayout layout;
+
+  int n = text.length();
+  float charW = 22 * scale;
+  float totalW = n * charW;
+  float startX = -totalW / 2.0f;
+  float sagHeight = 25.0f * scale;
+
+  auto getSagY = [&](float progress) {
+    return sagHeight * 4.0f * progress * (1.0f - progress);
+  };
+
+  // The connecting string
+  layout.garland.reserve(n * 8 + 1);
+  for (int i = 0; i <= n * 8; ++i) {
+    float progress = (float)i / (n * 8);
+    layout.garland.append(
+        QPointF(startX + progress * totalW, getSagY(progress)));
+  }
+
+  for (int i = 0; i < n; ++i) {
+    if (text[i].isSpace())
+      continue;
+
+    float pLeft = (float)i / n;
+    float pRight = (float)(i + 1) / n;
+
+    float x1 = startX + pLeft * totalW + 2;
+    float y1 = getSagY(pLeft + 2.0f / totalW);
+    float x2 = startX + pRight * totalW - 2;
+    float y2 = getSagY(pRight - 2.0f / totalW);
+
+    GarlandLayout::Card card;
+    card.index = i;
+    card.center = QPointF((x1 + x2) / 2.0f, (y1 + y2) / 2.0f + 8);
+    card.angle = std::atan2(y2 - y1, x2 - x1) * 180.0f / M_PI;
+    layout.cards.append(card);
+  }
+
+  return layout;
+}
+
+CardSpriteCache::CardSpriteCache() : m_font("Comic Sans MS", 14, QFont::Bold) {}
+
+const QPixmap &CardSpriteCache::card(QChar c, const QColor &color,
+                                     qreal dpr) {
+  if (dpr != m_dpr) {
+    m_cards.clear();
+    m_dpr = dpr;
+  }
+
+  quint64 key = (quint64(c.unicode()) << 32) | color.rgba();
+  auto it = m_cards.find(key);
+  if (it == m_cards.end())
+    it = m_cards.insert(key, render(c, color, dpr));
+  return *it;
+}
+
+QPixmap CardSpriteCache::render(QChar c, const QColor &color,
+                                qreal dpr) const {
+  QPixmap pixmap(QSize(kCardWidth, kCardHeight) * dpr);
+  pixmap.setDevicePixelRatio(dpr);
+  pixmap.fill(Qt::transparent);
+
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setFont(m_font);
+  painter.translate(kCardWidth / 2.0, kCardHeight / 2.0);
+
+  painter.setPen(QPen(color.darker(), 2));
+  painter.setBrush(color);
+  QRectF rect(-10, -12, 20, 24);
+  painter.drawRoundedRect(rect, 3, 3);
+
+  painter.setBrush(QColor(0, 0, 0, 100));
+  painter.setPen(Qt::NoPen);
+  painter.drawEllipse(QPointF(-7, -9), 2, 2);
+  painter.drawEllipse(QPointF(7, -9), 2, 2);
+
+  painter.setPen(Qt::white);
+  painter.drawText(rect, Qt::AlignCenter, QString(c));
+
+  return pixmap;
+}
@@ -0,0 +1,57 @@
+#ifndef MESSAGECACHE_H
+#define MESSAGECACHE_H
+
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QPixmap>
+#include <QPointF>
+#include <QPolygonF>
+#include <QString>
+#include <QVector>
+
+// Garland geometry of one message at one (quantized) pulse scale, relative to
+// the ornament position.
+struct GarlandLayout {
+  struct Card {
+    int index;      // character index in the message text
+    QPointF center; // card centre (already offset below the string)
+    float angle;    // resting angle in degrees, before the sway
+  };
+
+  QPolygonF garland;
+  QVector<Card> cards;
+};
+
+// Per-message cache of garland layouts. Layouts are rebuilt only when the
+// text changes or a new scale step is first seen.
+class MessageRenderCache {
+public:
+  const GarlandLayout &layout(const QString &text, float scale);
+
+private:
+  static GarlandLayout build(const QString &text, float scale);
+
+  QString m_text;
+  QHash<int, GarlandLayout> m_layouts;
+};
+
+// Pre-rendered cardboard letter cards shared by every message, keyed by
+// (character, card colour, device pixel ratio). The font is resolved once.
+class CardSpriteCache {
+public:
+  CardSpriteCache();
+
+  // Sprite centred on the card centre; its logical size is
+  // deviceIndependentSize().
+  const QPixmap &card(QChar c, const QColor &color, qreal dpr);
+
+private:
+  QPixmap render(QChar c, const QColor &color, qreal dpr) const;
+
+  QFont m_font;
+  QHash<quint64, QPixmap> m_cards;
+  qreal m_dpr = 0;
+};
+
+#endif // MESSAGECACHE_H
@@ -0,0 +1,156 @@
+#include "ornamentsprites.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <QRadialGradient>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Pulses stay within +-8%, so 0.01 steps over [0.9, 1.1] keep the sprite
+// within a fraction of a pixel of the exact size.
+constexpr float kMinScale = 0.9f;
+constexpr float kScaleStep = 0.01f;
+constexpr int kScaleSteps = 21;
+
+const OrnamentType kSpriteTypes[] = {OrnamentType::Red,    OrnamentType::Gold,
+                                     OrnamentType::Blue,   OrnamentType::Silver,
+                                     OrnamentType::Purple, OrnamentType::Star};
+
+int scaleStep(float scale) {
+  int step = static_cast<int>(std::lround((scale - kMinScale) / kScaleStep));
+  return std::clamp(step, 0, kScaleSteps - 1);
+}
+
+void paintBall(QPainter &painter, const QPointF &pos, const QColor &baseColor,
+               float scale, bool glow) {
+  // Outer Glow
+  if (glow) {
+    float glowSize = 18 * scale;
+    QRadialGradient gradient(pos, glowSize);
+    gradient.setColorAt(0.0, baseColor);
+    gradient.setColorAt(0.4, QColor(baseColor.red(), baseColor.green(),
+                                    baseColor.blue(), 150));
+    gradient.setColorAt(1.0, Qt::transparent);
+
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(gradient);
+    painter.drawEllipse(pos, glowSize, glowSize);
+  }
+
+  // Ornament body
+  painter.setBrush(baseColor);
+  painter.setPen(QPen(Qt::white, 1));
+  painter.drawEllipse(pos, 8 * scale, 8 * scale);
+
+  // Highlight
+  painter.setBrush(QColor(255, 255, 255, 180));
+  painter.setPen(Qt::NoPen);
+  painter.drawEllipse(pos + QPointF(-3, -3) * scale, 3 * scale, 3 * scale);
+}
+
+void paintStar(QPainter &painter, const QPointF &pos, float scale,
+               bool glow) {
+  // Outer glow
+  if (glow) {
+    QRadialGradient gradient(pos, 30 * scale);
+    gradient.setColorAt(0.0, QColor(255, 255, 200, 200));
+    gradient.setColorAt(0.5, QColor(255, 200, 0, 100));
+    gradient.setColorAt(1.0, Qt::transparent);
+    painter.setBrush(gradient);
+    painter.setPen(Qt::NoPen);
+    painter.drawEllipse(pos, 30 * scale, 30 * scale);
+  }
+
+  // Star shape
+  painter.setBrush(QColor(255, 220, 0));
+  painter.setPen(QPen(QColor(255, 165, 0), 1.5f));
+
+  QPainterPath path;
+  for (int i = 0; i < 5; ++i) {
+    float angle = -M_PI / 2 + i * 2 * M_PI / 5;
+    QPointF p(pos.x() + 15 * scale * cos(angle),
+              pos.y() + 15 * scale * sin(angle));
+    if (i == 0)
+      path.moveTo(p);
+    else
+      path.lineTo(p);
+
+    angle += M_PI / 5;
+    path.lineTo(pos.x() + 7 * scale * cos(angle),
+                pos.y() + 7 * scale * sin(angle));
+  }
+  path.closeSubpath();
+  painter.drawPath(path);
+}
+} // namespace
+
+const QPixmap &OrnamentSpriteCache::sprite(OrnamentType type, float scale,
+                                           qreal dpr) {
+  if (dpr != m_dpr) {
+    m_sprites.clear();
+    m_dpr = dpr;
+  }
+
+  int step = scaleStep(scale);
+  quint32 key = static_cast<quint32>(type) * kScaleSteps + step;
+  auto it = m_sprites.find(key);
+  if (it == m_sprites.end()) {
+    float quantized = kMinScale + step * kScaleStep;
+    it = m_sprites.insert(key, render(type, quantized, dpr, m_glow));
+  }
+  return *it;
+}
+
+void OrnamentSpriteCache::warm(qreal dpr) {
+  for (OrnamentType type : kSpriteTypes) {
+    for (int step = 0; step < kScaleSteps; ++step)
+      sprite(type, kMinScale + step * kScaleStep, dpr);
+  }
+}
+
+void OrnamentSpriteCache::setGlow(bool glow) {
+  if (glow == m_glow)
+    return;
+  m_glow = glow;
+  m_sprites.clear();
+}
+
+QPixmap OrnamentSpriteCache::render(OrnamentType type, float scale, qreal dpr,
+                                    bool glow) {
+  // Without the halo the sprite only needs to cover the body and its pen
+  float radius = glow ? (type == OrnamentType::Star ? 30.0f : 18.0f)
+                      : (type == OrnamentType::Star ? 16.0f : 9.0f);
+  radius = radius * scale + 1;
+  int side = static_cast<int>(std::ceil(2 * radius));
+
+  QPixmap pixmap(QSize(side, side) * dpr);
+  pixmap.setDevicePixelRatio(dpr);
+  pixmap.fill(Qt::transparent);
+
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing);
+  QPointF center(side / 2.0, side / 2.0);
+  if (type == OrnamentType::Star)
+    paintStar(painter, center, scale, glow);
+  else
+    paintBall(painter, center, baseColor(type), scale, glow);
+
+  return pixmap;
+}
+
+QColor OrnamentSpriteCache::baseColor(OrnamentType type) {
+  switch (type) {
+  case OrnamentType::Red:
+    return QColor(220, 20, 60);
+  case OrnamentType::Gold:
+    return QColor(255, 215, 0);
+  case OrnamentType::Blue:
+    return QColor(30, 144, 255);
+  case OrnamentType::Silver:
+    return QColor(192, 192, 192);
+  case OrnamentType::Purple:
+    return QColor(147, 112, 219);
+  default:
+    return Qt::white;
+  }
+}
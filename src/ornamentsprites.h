@@ -0,0 +1,37 @@
+#ifndef ORNAMENTSPRITES_H
+#define ORNAMENTSPRITES_H
+
+#include "tree_data.h"
+#include <QHash>
+#include <QPixmap>
+
+// Pre-rendered glow, body and highlight sprites for ball and star ornaments,
+// keyed by (type, quantized pulse scale, device pixel ratio). Drawing an
+// ornament becomes a single drawPixmap instead of a gradient setup and three
+// antialiased ellipses (or a star path).
+class OrnamentSpriteCache {
+public:
+  // Sprite centred on the ornament position; its logical size is
+  // deviceIndependentSize().
+  const QPixmap &sprite(OrnamentType type, float scale, qreal dpr);
+
+  // Renders every type and scale step up front so the first pulses do not
+  // pay for sprite creation.
+  void warm(qreal dpr);
+
+  // Without glow only the body and highlight are drawn, in a smaller sprite
+  void setGlow(bool glow);
+  bool glow() const { return m_glow; }
+
+  static QColor baseColor(OrnamentType type);
+
+private:
+  static QPixmap render(OrnamentType type, float scale, qreal dpr,
+                        bool glow);
+
+  QHash<quint32, QPixmap> m_sprites;
+  qreal m_dpr = 0;
+  bool m_glow = true;
+};
+
+#endif // ORNAMENTSPRITES_H
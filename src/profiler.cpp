@@ -0,0 +1,176 @@
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+
+std::atomic<bool> Profiler::s_enabled{false};
+
+namespace {
+constexpr int kEventCapacity = 1 << 17; // ~4 MB, several seconds of frames
+constexpr int kFrameHistory = 120;
+constexpr double kAverageWeight = 0.05;
+constexpr int kLatencyTrack = 0; // Threads are numbered from 1
+
+struct Event {
+  const char *name;
+  qint64 start;
+  qint64 duration;
+  int track;
+};
+
+struct State {
+  QElapsedTimer clock;
+  QMutex mutex;
+  QVector<Event> events; // Ring, grown up to kEventCapacity
+  int next = 0;
+  QHash<const char *, double> averages;
+  QVector<float> frames; // Ring of frame intervals in ms
+  int nextFrame = 0;
+  QVector<QString> trackNames{"input latency"};
+
+  State() { clock.start(); }
+};
+
+State &state() {
+  static State s;
+  return s;
+}
+
+// Small stable id per thread for the trace's tid field; needs the mutex
+int currentTrack(State &s) {
+  thread_local int track = 0;
+  if (track == 0) {
+    track = s.trackNames.size();
+    QCoreApplication *app = QCoreApplication::instance();
+    bool gui = app && QThread::currentThread() == app->thread();
+    s.trackNames.append(gui ? QStringLiteral("GUI")
+                            : QStringLiteral("worker %1").arg(track));
+  }
+  return track;
+}
+
+// Stores an event and folds it into its scope's average; needs the mutex
+void append(State &s, const Event &event) {
+  if (s.events.size() < kEventCapacity)
+    s.events.append(event);
+  else
+    s.events[s.next] = event;
+  s.next = (s.next + 1) % kEventCapacity;
+
+  double ms = event.duration / 1e6;
+  auto it = s.averages.find(event.name);
+  if (it == s.averages.end())
+    s.averages.insert(event.name, ms);
+  else
+    *it += (ms - *it) * kAverageWeight;
+}
+} // namespace
+
+void Profiler::setEnabled(bool enabled) {
+  state(); // Start the clock before the first scope reads it
+  s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Profiler::now() { return state().clock.nsecsElapsed(); }
+
+void Profiler::record(const char *name, qint64 start, qint64 end) {
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  append(s, {name, start, end - start, currentTrack(s)});
+}
+
+void Profiler::recordLatency(const char *name, qint64 start, qint64 end) {
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  append(s, {name, start, end - start, kLatencyTrack});
+}
+
+void Profiler::frameTick(float seconds) {
+  if (!isEnabled())
+    return;
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  if (s.frames.size() < kFrameHistory)
+    s.frames.append(seconds * 1000.0f);
+  else
+    s.frames[s.nextFrame] = seconds * 1000.0f;
+  s.nextFrame = (s.nextFrame + 1) % kFrameHistory;
+}
+
+QVector<Profiler::ScopeStat> Profiler::scopeStats() {
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  QVector<ScopeStat> stats;
+  stats.reserve(s.averages.size());
+  for (auto it = s.averages.cbegin(); it != s.averages.cend(); ++it)
+    stats.append({it.key(), it.value()});
+  return stats;
+}
+
+QVector<float> Profiler::frameTimes() {
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  if (s.frames.size() < kFrameHistory)
+    return s.frames;
+  QVector<float> ordered = s.frames.mid(s.nextFrame);
+  ordered += s.frames.mid(0, s.nextFrame);
+  return ordered;
+}
+
+bool Profiler::hasEvents() {
+  State &s = state();
+  QMutexLocker locker(&s.mutex);
+  return !s.events.isEmpty();
+}
+
+bool Profiler::writeTrace(const QString &path, QString *error) {
+  State &s = state();
+  QJsonArray events;
+  {
+    QMutexLocker locker(&s.mutex);
+    const qint64 pid = QCoreApplication::applicationPid();
+    for (int i = 0; i < s.trackNames.size(); ++i) {
+      QJsonObject meta;
+      meta["name"] = "thread_name";
+      meta["ph"] = "M";
+      meta["pid"] = pid;
+      meta["tid"] = i;
+      meta["args"] = QJsonObject{{"name", s.trackNames[i]}};
+      events.append(meta);
+    }
+    // Oldest first once the ring has wrapped
+    int count = s.events.size();
+    int first = count < kEventCapacity ? 0 : s.next;
+    for (int i = 0; i < count; ++i) {
+      const Event &event = s.events[(first + i) % count];
+      QJsonObject object;
+      object["name"] = QString::fromLatin1(event.name);
+      object["ph"] = "X";
+      object["ts"] = event.start / 1000.0; // microseconds
+      object["dur"] = event.duration / 1000.0;
+      object["pid"] = pid;
+      object["tid"] = event.track;
+      events.append(object);
+    }
+  }
+
+  QJsonObject root;
+  root["traceEvents"] = events;
+  root["displayTimeUnit"] = "ms";
+
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 ||
+      !file.commit()) {
+    if (error)
+      *error = file.errorString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,61 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+// Scoped timers for the hot paths. While disabled a ProfileScope costs one
+// relaxed atomic load and a branch. While enabled every scope appends a
+// complete event to a ring holding the most recent events of all threads,
+// which writeTrace() dumps in Chrome's trace-event format (chrome://tracing,
+// Perfetto), and feeds a per-scope running average for the HUD.
+class Profiler {
+public:
+  static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enabled);
+
+  // Nanoseconds on the profiler's monotonic clock
+  static qint64 now();
+  // Appends a [start, end] event; `name` must outlive the profiler, which
+  // string literals do
+  static void record(const char *name, qint64 start, qint64 end);
+  // Like record(), on a separate track since the span crosses handlers
+  static void recordLatency(const char *name, qint64 start, qint64 end);
+  // Called once per animation frame with the interval since the last one
+  static void frameTick(float seconds);
+
+  struct ScopeStat {
+    const char *name;
+    double averageMs; // Exponential moving average
+  };
+  static QVector<ScopeStat> scopeStats();
+  static QVector<float> frameTimes(); // Recent intervals in ms, oldest first
+
+  static bool hasEvents();
+  static bool writeTrace(const QString &path, QString *error = nullptr);
+
+private:
+  static std::atomic<bool> s_enabled;
+};
+
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name)
+      : m_name(Profiler::isEnabled() ? name : nullptr) {
+    if (m_name)
+      m_start = Profiler::now();
+  }
+  ~ProfileScope() {
+    if (m_name)
+      Profiler::record(m_name, m_start, Profiler::now());
+  }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  const char *m_name;
+  qint64 m_start = 0;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,95 @@
+#include "qualitygovernor.h"
+#include "frameclock.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+std::atomic<qint64> QualityGovernor::s_costNs{0};
+
+namespace {
+// Glow and antialiasing go first, then flakes in small steps; the frame
+// rate is only capped once a good share of the snow is already gone
+const QualityLevel kLevels[] = {
+    {1.00f, true, true, 0},    {1.00f, true, false, 0},
+    {1.00f, false, false, 0},  {0.85f, false, false, 0},
+    {0.70f, false, false, 0},  {0.55f, false, false, 0},
+    {0.55f, false, false, 30}, {0.40f, false, false, 30},
+    {0.25f, false, false, 30},
+};
+constexpr int kLevelCount = int(std::size(kLevels));
+
+constexpr int kWindowFrames = 30;
+constexpr int kLowerAfter = 2;     // Windows over budget before dropping
+constexpr int kRaiseAfter = 6;     // Initial headroom windows before raising
+constexpr int kMaxRaiseAfter = 96; // About 50 s at 60 Hz
+constexpr double kHeadroom = 0.6;  // Raise only below this share of budget
+constexpr int kProbeWindows = 4;   // A drop this soon undoes a failed raise
+} // namespace
+
+QualityGovernor *QualityGovernor::instance() {
+  static QualityGovernor *governor = new QualityGovernor();
+  return governor;
+}
+
+QualityGovernor::QualityGovernor(QObject *parent)
+    : QObject(parent), m_raiseWindows(kRaiseAfter) {
+  connect(FrameClock::instance(), &FrameClock::frame, this,
+          &QualityGovernor::onFrame);
+}
+
+void QualityGovernor::setBudget(double ms) {
+  m_budgetMs = std::max(0.0, ms);
+  s_costNs.store(0);
+  m_frames = m_overWindows = m_underWindows = 0;
+  m_raiseWindows = kRaiseAfter;
+  m_sinceRaise = -1;
+  if (m_budgetMs == 0)
+    setLevel(0);
+}
+
+const QualityLevel &QualityGovernor::quality() const {
+  return kLevels[m_level];
+}
+
+int QualityGovernor::levelCount() const { return kLevelCount; }
+
+int QualityGovernor::effectiveFlakes(int requested) const {
+  return static_cast<int>(std::lround(requested * kLevels[m_level].flakeScale));
+}
+
+void QualityGovernor::onFrame() {
+  if (m_budgetMs == 0 || ++m_frames < kWindowFrames)
+    return;
+  double costMs = s_costNs.exchange(0) / 1e6 / m_frames;
+  m_frames = 0;
+  if (m_sinceRaise >= 0 && ++m_sinceRaise > kProbeWindows)
+    m_sinceRaise = -1; // The last raise held
+
+  if (costMs > m_budgetMs) {
+    m_underWindows = 0;
+    if (++m_overWindows < kLowerAfter || m_level == kLevelCount - 1)
+      return;
+    if (m_sinceRaise >= 0)
+      m_raiseWindows = std::min(m_raiseWindows * 2, kMaxRaiseAfter);
+    m_overWindows = 0;
+    m_sinceRaise = -1;
+    setLevel(m_level + 1);
+  } else if (costMs < m_budgetMs * kHeadroom) {
+    m_overWindows = 0;
+    if (++m_underWindows < m_raiseWindows || m_level == 0)
+      return;
+    m_underWindows = 0;
+    m_sinceRaise = 0;
+    setLevel(m_level - 1);
+  } else {
+    m_overWindows = m_underWindows = 0;
+  }
+}
+
+void QualityGovernor::setLevel(int level) {
+  if (level == m_level)
+    return;
+  m_level = level;
+  FrameClock::instance()->setFrameRateCap(kLevels[level].maxFrameRate);
+  emit qualityChanged();
+}
@@ -0,0 +1,73 @@
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <atomic>
+
+// One rung of the quality ladder
+struct QualityLevel {
+  float flakeScale;  // Fraction of the requested flakes actually simulated
+  bool antialiasing; // Tree and painter-backend snow
+  bool glow;         // Halo gradients around ornament sprites
+  int maxFrameRate;  // 0 for the display rate
+};
+
+// Holds the CPU cost of a frame under a budget by walking a fixed quality
+// ladder. Cost is the time spent in frame updates, paints and snow steps on
+// any thread, averaged over half-second windows. Over budget for two windows
+// drops a rung; well under it for longer raises one, and a raise that has to
+// be undone right away makes the next raise wait twice as long, so the level
+// settles instead of oscillating. Cheap losses (glow, antialiasing) come
+// before fewer flakes, so density stays as close to the request as the
+// machine allows.
+class QualityGovernor : public QObject {
+  Q_OBJECT
+public:
+  static QualityGovernor *instance();
+
+  // Milliseconds of work per frame; 0 pins full quality
+  void setBudget(double ms);
+  double budget() const { return m_budgetMs; }
+
+  const QualityLevel &quality() const;
+  int level() const { return m_level; }
+  int levelCount() const;
+  int effectiveFlakes(int requested) const;
+
+  // Thread-safe; work measured by FrameCostScope
+  static void addCost(qint64 ns) {
+    s_costNs.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+signals:
+  void qualityChanged();
+
+private:
+  explicit QualityGovernor(QObject *parent = nullptr);
+  void onFrame();
+  void setLevel(int level);
+
+  static std::atomic<qint64> s_costNs;
+  double m_budgetMs = 8.0;
+  int m_level = 0;
+  int m_frames = 0;       // In the current window
+  int m_overWindows = 0;  // Consecutive windows over budget
+  int m_underWindows = 0; // Consecutive windows with headroom
+  int m_raiseWindows;     // Headroom windows needed before a raise
+  int m_sinceRaise = -1;  // Windows since the last raise, -1 if settled
+};
+
+// Adds the time until the end of the scope to the current frame's cost
+class FrameCostScope {
+public:
+  FrameCostScope() { m_timer.start(); }
+  ~FrameCostScope() { QualityGovernor::addCost(m_timer.nsecsElapsed()); }
+  FrameCostScope(const FrameCostScope &) = delete;
+  FrameCostScope &operator=(const FrameCostScope &) = delete;
+
+private:
+  QElapsedTimer m_timer;
+};
+
+#endif // QUALITYGOVERNOR_H
@@ -0,0 +1,43 @@
+#include "rng.h"
+#include <QHash>
+#include <QMutex>
+#include <QRandomGenerator>
+
+namespace {
+QMutex s_mutex;
+bool s_seeded = false;
+quint64 s_seed = 0;
+QHash<QByteArray, quint64> s_streams;
+
+quint64 fnv1a(const char *text) {
+  quint64 hash = 14695981039346656037ULL;
+  for (; *text; ++text) {
+    hash ^= quint8(*text);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+} // namespace
+
+void Rng::setSeed(quint64 seed) {
+  QMutexLocker lock(&s_mutex);
+  s_seed = seed;
+  s_seeded = true;
+  s_streams.clear();
+}
+
+quint64 Rng::seed() {
+  QMutexLocker lock(&s_mutex);
+  if (!s_seeded) {
+    s_seed = QRandomGenerator::system()->generate64();
+    s_seeded = true;
+  }
+  return s_seed;
+}
+
+Rng Rng::forSubsystem(const char *name) {
+  quint64 base = seed();
+  QMutexLocker lock(&s_mutex);
+  quint64 instance = s_streams[QByteArray(name)]++;
+  return Rng(base, fnv1a(name) + instance * 0x9e3779b97f4a7c15ULL);
+}
@@ -0,0 +1,53 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <QtGlobal>
+
+// Small PCG32 generator (O'Neill, pcg-random.org). Each subsystem owns one,
+// so hot loops draw without the locking of QRandomGenerator::global(), and a
+// process-wide seed makes every stream reproducible. Not thread-safe: an
+// instance belongs to whichever thread runs its subsystem.
+class Rng {
+public:
+  explicit Rng(quint64 seed, quint64 stream = 0) : m_inc((stream << 1) | 1) {
+    next();
+    m_state += seed;
+    next();
+  }
+
+  // Stream for one subsystem instance, derived from the process seed, the
+  // subsystem name and how many streams that name has handed out so far.
+  // Construction order decides the sequence, so seeded runs that build the
+  // scene the same way draw the same numbers.
+  static Rng forSubsystem(const char *name);
+  // Fixes the process seed; call before any subsystem is created. Without
+  // it the seed comes from the system generator.
+  static void setSeed(quint64 seed);
+  static quint64 seed();
+
+  quint32 next() {
+    quint64 old = m_state;
+    m_state = old * 6364136223846793005ULL + m_inc;
+    quint32 xorshifted = quint32(((old >> 18) ^ old) >> 27);
+    quint32 rot = quint32(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+  }
+
+  // Uniform in [0, 1)
+  double generateDouble() { return next() * (1.0 / 4294967296.0); }
+  float generateFloat() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+  // Uniform in [0, bound) and [low, high); multiply-shift range reduction,
+  // whose bias is far below anything visible here
+  int bounded(int bound) {
+    return int((quint64(next()) * quint32(bound)) >> 32);
+  }
+  int bounded(int low, int high) { return low + bounded(high - low); }
+  double bounded(double bound) { return generateDouble() * bound; }
+
+private:
+  quint64 m_state = 0;
+  quint64 m_inc;
+};
+
+#endif // RNG_H
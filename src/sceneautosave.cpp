@@ -0,0 +1,63 @@
+#include "sceneautosave.h"
+#include "scenefile.h"
+#include "treewidget.h"
+#include <QCoreApplication>
+#include <QMetaObject>
+
+namespace {
+constexpr int kDebounceMs = 2000;
+} // namespace
+
+SceneAutosave::SceneAutosave(TreeWidget *tree, const QString &path,
+                             QObject *parent)
+    : QObject(parent), m_tree(tree), m_path(path) {
+  m_pool.setMaxThreadCount(1);
+  m_debounce.setSingleShot(true);
+  m_debounce.setInterval(kDebounceMs);
+  connect(&m_debounce, &QTimer::timeout, this, &SceneAutosave::startWrite);
+  connect(tree, &TreeWidget::sceneChanged, this,
+          &SceneAutosave::scheduleSave);
+  connect(qApp, &QCoreApplication::aboutToQuit, this, &SceneAutosave::flush);
+}
+
+SceneAutosave::~SceneAutosave() { m_pool.waitForDone(); }
+
+void SceneAutosave::scheduleSave() {
+  m_pending = true;
+  m_debounce.start(); // Restarts, so a burst of edits saves once
+}
+
+void SceneAutosave::startWrite() {
+  if (m_writing)
+    return; // writeFinished() picks the pending edit up
+  m_writing = true;
+  m_pending = false;
+
+  SceneData scene = m_tree->saveScene();
+  QString path = m_path;
+  m_pool.start([this, scene = std::move(scene), path]() {
+    QString error;
+    if (!SceneFile::save(path, scene, &error))
+      qWarning("Scene autosave failed: %s", qPrintable(error));
+    QMetaObject::invokeMethod(this, &SceneAutosave::writeFinished,
+                              Qt::QueuedConnection);
+  });
+}
+
+void SceneAutosave::writeFinished() {
+  m_writing = false;
+  if (m_pending && !m_debounce.isActive())
+    startWrite();
+}
+
+void SceneAutosave::flush() {
+  m_debounce.stop();
+  m_pool.waitForDone();
+  m_writing = false;
+  if (!m_pending)
+    return;
+  m_pending = false;
+  QString error;
+  if (!SceneFile::save(m_path, m_tree->saveScene(), &error))
+    qWarning("Scene autosave failed: %s", qPrintable(error));
+}
@@ -0,0 +1,38 @@
+#ifndef SCENEAUTOSAVE_H
+#define SCENEAUTOSAVE_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+class TreeWidget;
+
+// Writes the tree's scene to disk a moment after the last edit. The snapshot
+// is taken on the GUI thread; encoding and the atomic file replace run on a
+// private worker so a slow disk never stalls a frame. At most one write is in
+// flight; edits made meanwhile are folded into a single follow-up write.
+class SceneAutosave : public QObject {
+  Q_OBJECT
+public:
+  SceneAutosave(TreeWidget *tree, const QString &path,
+                QObject *parent = nullptr);
+  ~SceneAutosave() override;
+
+  // Writes any pending edit synchronously; called on quit
+  void flush();
+
+private:
+  void scheduleSave();
+  void startWrite();
+  void writeFinished();
+
+  TreeWidget *m_tree;
+  QString m_path;
+  QTimer m_debounce;
+  QThreadPool m_pool;
+  bool m_writing = false;
+  bool m_pending = false; // Edited since the last snapshot was taken
+};
+
+#endif // SCENEAUTOSAVE_H
@@ -0,0 +1,213 @@
+#include "scenefile.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace {
+constexpr quint32 kMagic = 0x534d5358; // "XSMS" read little-endian
+constexpr quint32 kVersion = 1;
+
+struct Header {
+  quint32 magic;
+  quint32 version;
+  quint32 treeType;
+  qint32 backSnow;
+  quint64 treeSeed;
+  qint32 frontSnow;
+  quint32 ornamentCount;
+  quint32 messageCount;
+  quint32 giftCount;
+  quint32 textLength;
+  quint32 reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<SceneData::OrnamentRecord> &&
+                  std::is_trivially_copyable_v<SceneData::MessageRecord> &&
+                  std::is_trivially_copyable_v<SceneData::GiftRecord>,
+              "scene records are written as raw bytes");
+static_assert(sizeof(SceneData::OrnamentRecord) == 20 &&
+                  sizeof(SceneData::MessageRecord) == 8 &&
+                  sizeof(SceneData::GiftRecord) == 16 && sizeof(Header) == 48,
+              "scene file layout changed; bump kVersion");
+
+template <typename T> qint64 byteSize(const QVector<T> &array) {
+  return qint64(array.size()) * sizeof(T);
+}
+
+// Copies `count` records from the mapped file, advancing `cursor`
+template <typename T>
+bool readArray(const uchar *&cursor, const uchar *end, quint32 count,
+               QVector<T> &out) {
+  qint64 bytes = qint64(count) * sizeof(T);
+  if (end - cursor < bytes)
+    return false;
+  out.resize(count);
+  std::memcpy(out.data(), cursor, bytes);
+  cursor += bytes;
+  return true;
+}
+
+bool fail(QString *error, const QString &message) {
+  if (error)
+    *error = message;
+  return false;
+}
+
+const char *const kTreeTypes[] = {"classic", "snowy", "dark", "procedural"};
+const char *const kOrnamentTypes[] = {"red",    "gold", "blue",    "silver",
+                                      "purple", "star", "message", "gift"};
+const char *const kGiftColors[] = {"red", "blue", "gold"};
+const char *const kGiftSizes[] = {"small", "medium", "large"};
+
+template <size_t N>
+QString nameOf(const char *const (&names)[N], quint32 value) {
+  return value < N ? QString::fromLatin1(names[value]) : QString::number(value);
+}
+} // namespace
+
+QString SceneFile::defaultPath() {
+  QString dir =
+      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  return QDir(dir).filePath("scene.xmas");
+}
+
+bool SceneFile::save(const QString &path, const SceneData &scene,
+                     QString *error) {
+  Header header = {};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.treeType = scene.treeType;
+  header.treeSeed = scene.treeSeed;
+  header.backSnow = scene.backSnow;
+  header.frontSnow = scene.frontSnow;
+  header.ornamentCount = scene.ornaments.size();
+  header.messageCount = scene.messages.size();
+  header.giftCount = scene.gifts.size();
+  header.textLength = scene.text.size();
+  if (scene.colors.size() != scene.text.size())
+    return fail(error, "message colors do not match message text");
+
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+    return fail(error, file.errorString());
+
+  auto write = [&file](const void *data, qint64 size) {
+    return size == 0 ||
+           file.write(static_cast<const char *>(data), size) == size;
+  };
+  bool ok = write(&header, sizeof(header)) &&
+            write(scene.ornaments.constData(), byteSize(scene.ornaments)) &&
+            write(scene.messages.constData(), byteSize(scene.messages)) &&
+            write(scene.gifts.constData(), byteSize(scene.gifts)) &&
+            write(scene.text.constData(), byteSize(scene.text)) &&
+            write(scene.colors.constData(), byteSize(scene.colors));
+  if (!ok || !file.commit())
+    return fail(error, file.errorString());
+  return true;
+}
+
+bool SceneFile::load(const QString &path, SceneData &scene, QString *error) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    return fail(error, file.errorString());
+  qint64 size = file.size();
+  if (size < qint64(sizeof(Header)))
+    return fail(error, "not a scene file");
+
+  const uchar *data = file.map(0, size);
+  if (!data)
+    return fail(error, file.errorString());
+  const uchar *cursor = data;
+  const uchar *end = data + size;
+
+  Header header;
+  std::memcpy(&header, cursor, sizeof(header));
+  cursor += sizeof(header);
+  if (header.magic != kMagic)
+    return fail(error, "not a scene file");
+  if (header.version != kVersion)
+    return fail(error, QString("unsupported scene version %1")
+                           .arg(header.version));
+
+  SceneData loaded;
+  loaded.treeType = header.treeType;
+  loaded.treeSeed = header.treeSeed;
+  loaded.backSnow = header.backSnow;
+  loaded.frontSnow = header.frontSnow;
+  if (!readArray(cursor, end, header.ornamentCount, loaded.ornaments) ||
+      !readArray(cursor, end, header.messageCount, loaded.messages) ||
+      !readArray(cursor, end, header.giftCount, loaded.gifts) ||
+      !readArray(cursor, end, header.textLength, loaded.text) ||
+      !readArray(cursor, end, header.textLength, loaded.colors))
+    return fail(error, "scene file is truncated");
+
+  // Indices are checked once here so the scene code can trust them
+  for (const auto &message : std::as_const(loaded.messages)) {
+    if (message.offset > header.textLength ||
+        message.length > header.textLength - message.offset)
+      return fail(error, "scene file is corrupt");
+  }
+  for (const auto &ornament : std::as_const(loaded.ornaments)) {
+    if (ornament.message >= qint32(header.messageCount))
+      return fail(error, "scene file is corrupt");
+  }
+
+  scene = std::move(loaded);
+  return true;
+}
+
+QJsonDocument SceneFile::toJson(const SceneData &scene) {
+  QJsonObject root;
+  root["version"] = int(kVersion);
+  root["tree"] = nameOf(kTreeTypes, scene.treeType);
+  root["treeSeed"] = QString::number(scene.treeSeed);
+  if (scene.backSnow >= 0 || scene.frontSnow >= 0) {
+    QJsonObject snow;
+    snow["back"] = scene.backSnow;
+    snow["front"] = scene.frontSnow;
+    root["snow"] = snow;
+  }
+
+  QJsonArray ornaments;
+  for (const auto &record : scene.ornaments) {
+    QJsonObject ornament;
+    ornament["type"] = nameOf(kOrnamentTypes, record.type);
+    ornament["x"] = record.x;
+    ornament["y"] = record.y;
+    ornament["phase"] = record.pulsePhase;
+    if (record.message >= 0) {
+      const auto &message = scene.messages[record.message];
+      ornament["text"] = QString::fromUtf16(
+          scene.text.constData() + message.offset, message.length);
+      QJsonArray colors;
+      for (quint32 i = 0; i < message.length; ++i)
+        colors.append(scene.colors[message.offset + i]);
+      ornament["colors"] = colors;
+    }
+    ornaments.append(ornament);
+  }
+  root["ornaments"] = ornaments;
+
+  QJsonArray gifts;
+  for (const auto &record : scene.gifts) {
+    QJsonObject gift;
+    gift["color"] = nameOf(kGiftColors, record.color);
+    gift["size"] = nameOf(kGiftSizes, record.size);
+    gift["x"] = record.x;
+    gift["y"] = record.y;
+    gift["rotation"] = record.rotation;
+    gift["asleep"] = bool(record.flags & SceneData::GiftAsleep);
+    gifts.append(gift);
+  }
+  root["gifts"] = gifts;
+
+  return QJsonDocument(root);
+}
@@ -0,0 +1,57 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <QJsonDocument>
+#include <QString>
+#include <QVector>
+
+// Everything needed to rebuild a decorated scene. The record structs are
+// also the on-disk layout, so a file loads with one mapping and a memcpy
+// per array.
+struct SceneData {
+  struct OrnamentRecord {
+    float x, y;
+    float pulsePhase;
+    quint8 type; // OrnamentType
+    quint8 reserved[3];
+    qint32 message; // Index into messages, -1 for none
+  };
+  struct MessageRecord {
+    quint32 offset; // Into text and colors
+    quint32 length;
+  };
+  struct GiftRecord {
+    float x, y;
+    float rotation; // Degrees
+    quint8 color;   // GiftColor
+    quint8 size;    // GiftSize
+    quint8 flags;   // GiftFlags; 0 in files from before they existed
+    quint8 reserved;
+  };
+  enum GiftFlags : quint8 {
+    GiftAsleep = 1, // Resting; restored without simulating the pile again
+  };
+
+  quint32 treeType = 0; // TreeType
+  quint64 treeSeed = 0; // Shape of the procedural tree
+  qint32 backSnow = -1; // Flakes per snow column, -1 if not recorded
+  qint32 frontSnow = -1;
+  QVector<OrnamentRecord> ornaments;
+  QVector<MessageRecord> messages;
+  QVector<GiftRecord> gifts;
+  QVector<char16_t> text; // Message characters, back to back
+  QVector<quint8> colors; // Palette index per message character
+};
+
+// Versioned binary scene files plus a JSON export for humans. The binary
+// form is native little-endian; files from another byte order or version
+// are rejected rather than converted.
+namespace SceneFile {
+QString defaultPath();
+bool save(const QString &path, const SceneData &scene,
+          QString *error = nullptr);
+bool load(const QString &path, SceneData &scene, QString *error = nullptr);
+QJsonDocument toJson(const SceneData &scene);
+} // namespace SceneFile
+
+#endif // SCENEFILE_H
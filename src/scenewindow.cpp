@@ -0,0 +1,73 @@
+#include "scenewindow.h"
+#include "inputregion.h"
+#include "snowoverlay.h"
+#include "treewidget.h"
+#include <QApplication>
+#include <QEvent>
+#include <QPainter>
+#include <QScreen>
+
+SceneWindow::SceneWindow(QWidget *parent) : QWidget(parent) {
+  setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
+                 Qt::Tool | Qt::WindowDoesNotAcceptFocus |
+                 Qt::NoDropShadowWindowHint);
+  setAttribute(Qt::WA_TranslucentBackground);
+  setAttribute(Qt::WA_ShowWithoutActivating);
+
+  // Creation order is stacking order: back snow, tree, front snow
+  m_backSnow = new SnowOverlay(false, this);
+  m_tree = new TreeWidget(this);
+  m_frontSnow = new SnowOverlay(true, this);
+  m_tree->setSnowLayers(m_backSnow, m_frontSnow);
+  setFixedSize(m_backSnow->size());
+
+  // The snow layers are transparent for mouse events, so input inside the
+  // region goes straight to the tree
+  m_tree->installEventFilter(this);
+}
+
+void SceneWindow::placeTree(const QPoint &pos) {
+  QScreen *screen = QApplication::screenAt(pos);
+  if (!screen)
+    screen = QApplication::primaryScreen();
+  move(pos.x(), screen->geometry().top());
+  m_tree->move(0, pos.y() - screen->geometry().top());
+}
+
+void SceneWindow::setVisible(bool visible) {
+  QWidget::setVisible(visible);
+  if (visible) {
+    m_inputRegion = QRegion(); // The native window may be new
+    syncInputRegion();
+  }
+}
+
+bool SceneWindow::eventFilter(QObject *watched, QEvent *event) {
+  if (watched == m_tree &&
+      (event->type() == QEvent::Move || event->type() == QEvent::Resize))
+    syncInputRegion();
+  return QWidget::eventFilter(watched, event);
+}
+
+void SceneWindow::paintEvent(QPaintEvent *) {
+  // Invisible, but keeps these pixels hit-testable where alpha 0 is
+  // click-through; the children paint over it
+  QPainter painter(this);
+  painter.setClipRegion(m_inputRegion);
+  painter.fillRect(rect(), QColor(0, 0, 0, 1));
+}
+
+QRegion SceneWindow::inputRegion() const {
+  // The tree keeps full-rectangle interaction (see TreeWidget::updateMask)
+  return QRegion(m_tree->geometry());
+}
+
+void SceneWindow::syncInputRegion() {
+  const QRegion region = inputRegion();
+  if (region == m_inputRegion)
+    return;
+  update(region.united(m_inputRegion));
+  m_inputRegion = region;
+  if (isVisible())
+    setInputRegion(this, region);
+}
@@ -0,0 +1,46 @@
+#ifndef SCENEWINDOW_H
+#define SCENEWINDOW_H
+
+#include <QRegion>
+#include <QWidget>
+
+class SnowOverlay;
+class TreeWidget;
+
+// One translucent window holding back snow, tree and front snow as stacked
+// child widgets, so the scene is composited in a single paint pass and
+// backing store rather than by the window manager across three windows.
+//
+// Only the tree takes input. Its rectangle is the window's input region,
+// set as a native input shape where the platform has one and painted at
+// alpha 1 for platforms that hit-test per pixel; everywhere else clicks
+// fall through to the desktop. Mask-based clipping is avoided because it
+// would clip the snow too.
+class SceneWindow : public QWidget {
+  Q_OBJECT
+public:
+  explicit SceneWindow(QWidget *parent = nullptr);
+
+  TreeWidget *tree() const { return m_tree; }
+  SnowOverlay *backSnow() const { return m_backSnow; }
+  SnowOverlay *frontSnow() const { return m_frontSnow; }
+
+  // Places the tree's top-left corner at `pos` in global coordinates
+  void placeTree(const QPoint &pos);
+  void setVisible(bool visible) override;
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+  void paintEvent(QPaintEvent *event) override;
+
+private:
+  QRegion inputRegion() const;
+  void syncInputRegion();
+
+  SnowOverlay *m_backSnow;
+  TreeWidget *m_tree;
+  SnowOverlay *m_frontSnow;
+  QRegion m_inputRegion; // Last applied, in window coordinates
+};
+
+#endif // SCENEWINDOW_H
@@ -0,0 +1,10 @@
+#include "sinetable.h"
+
+namespace SineTable {
+const std::array<float, kSize + 2> kValues = [] {
+  std::array<float, kSize + 2> values{};
+  for (int i = 0; i < kSize + 2; ++i)
+    values[i] = static_cast<float>(std::sin(kTwoPi * i / kSize));
+  return values;
+}();
+} // namespace SineTable
@@ -0,0 +1,167 @@
+#include "snowcover.h"
+#include "treemask.h"
+#include <QPainter>
+#include <QPolygonF>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float kMaxDepth = 14.0f;    // px on flat ground
+constexpr float kSnowPerFlake = 0.6f; // px^2 of cover per px^2 of flake
+constexpr float kMeltInterval = 1.0f; // s between melt steps
+constexpr float kMeltRate = 0.03f;    // px/s
+constexpr float kVisibleDepth = 0.25f;
+constexpr int kSlopeSpan = 2; // px either side when sampling the slope
+} // namespace
+
+void SnowCover::build(const TreeMask &mask, float floorY) {
+  const int width = mask.size().width();
+  const int height = mask.size().height();
+  m_ground.resize(width);
+  m_capacity.resize(width);
+
+  for (int x = 0; x < width; ++x) {
+    // First tree pixel from the top, or the floor under open sky
+    float ground = floorY;
+    for (int y = 0; y < std::min<int>(height, floorY); ++y) {
+      if (mask.contains(QPointF(x + 0.5, y + 0.5))) {
+        ground = y;
+        break;
+      }
+    }
+    m_ground[x] = ground;
+
+    // The distance field grows away from the outline, so its gradient just
+    // above the ground is the surface normal; flat means pointing straight up
+    float flatness = 1.0f;
+    if (ground < floorY) {
+      QPointF at(x + 0.5, ground - kSlopeSpan);
+      float gx = mask.distance(at + QPointF(kSlopeSpan, 0)) -
+                 mask.distance(at - QPointF(kSlopeSpan, 0));
+      float gy = mask.distance(at + QPointF(0, kSlopeSpan)) -
+                 mask.distance(at - QPointF(0, kSlopeSpan));
+      float length = std::hypot(gx, gy);
+      flatness = length > 0 ? std::max(0.0f, -gy / length) : 0.0f;
+    }
+    m_capacity[x] = kMaxDepth * flatness * flatness;
+  }
+
+  // The chamfer field is blocky; smooth capacity so ledges look even
+  QVector<float> raw = m_capacity;
+  for (int x = 1; x + 1 < width; ++x)
+    m_capacity[x] = (raw[x - 1] + 2 * raw[x] + raw[x + 1]) / 4;
+
+  m_depth.fill(0.0f, width);
+  m_surface = m_ground;
+  m_meltClock = 0;
+  m_hasSnow = false;
+  touch(0, width);
+}
+
+void SnowCover::clear() {
+  m_depth.fill(0.0f);
+  m_surface = m_ground;
+  m_hasSnow = false;
+  touch(0, m_depth.size());
+}
+
+void SnowCover::deposit(float x, float size) {
+  // Spread over a small tent so single flakes do not build spikes
+  const int center = static_cast<int>(x);
+  const int radius = std::max(1, static_cast<int>(std::ceil(size)));
+  const float amount = kSnowPerFlake * float(M_PI) * size * size;
+  const float weightSum = float(radius + 1) * float(radius + 1);
+  const int begin = std::max(0, center - radius);
+  const int end = std::min<int>(m_depth.size(), center + radius + 1);
+  if (begin >= end)
+    return;
+  for (int c = begin; c < end; ++c) {
+    float weight = (radius + 1 - std::abs(c - center)) / weightSum;
+    m_depth[c] = std::min(m_capacity[c], m_depth[c] + amount * weight);
+    m_surface[c] = m_ground[c] - m_depth[c];
+  }
+  m_hasSnow = true;
+  touch(begin, end);
+}
+
+void SnowCover::melt(float dt) {
+  m_meltClock += dt;
+  if (m_meltClock < kMeltInterval)
+    return;
+  const float amount = kMeltRate * m_meltClock;
+  m_meltClock = 0;
+
+  int first = -1, last = -1;
+  m_hasSnow = false;
+  for (int c = 0; c < m_depth.size(); ++c) {
+    if (m_depth[c] <= 0)
+      continue;
+    m_depth[c] = std::max(0.0f, m_depth[c] - amount);
+    m_surface[c] = m_ground[c] - m_depth[c];
+    m_hasSnow = m_hasSnow || m_depth[c] > 0;
+    if (first < 0)
+      first = c;
+    last = c;
+  }
+  if (first >= 0)
+    touch(first, last + 1);
+}
+
+void SnowCover::touch(int begin, int end) {
+  if (m_dirtyBegin == m_dirtyEnd) {
+    m_dirtyBegin = begin;
+    m_dirtyEnd = end;
+  } else {
+    m_dirtyBegin = std::min(m_dirtyBegin, begin);
+    m_dirtyEnd = std::max(m_dirtyEnd, end);
+  }
+  ++m_revision;
+}
+
+QRect SnowCover::takeDirty() {
+  if (m_dirtyBegin == m_dirtyEnd)
+    return QRect();
+  float top = m_ground[m_dirtyBegin];
+  float bottom = top;
+  for (int c = m_dirtyBegin; c < m_dirtyEnd; ++c) {
+    // The old surface may have been higher, so cover the full capacity
+    top = std::min(top, m_ground[c] - m_capacity[c]);
+    bottom = std::max(bottom, m_ground[c]);
+  }
+  QRect dirty(QPoint(m_dirtyBegin - 1, static_cast<int>(std::floor(top)) - 1),
+              QPoint(m_dirtyEnd, static_cast<int>(std::ceil(bottom)) + 1));
+  m_dirtyBegin = m_dirtyEnd = 0;
+  return dirty;
+}
+
+void SnowCover::draw(QPainter &painter, const QRect &clip) const {
+  const int begin = std::max(0, clip.left() - 1);
+  const int end = std::min<int>(m_depth.size(), clip.right() + 2);
+
+  painter.save();
+  painter.setPen(Qt::NoPen);
+  painter.setBrush(QColor(248, 251, 255));
+  // One polygon per run of snowy columns: along the snow surface left to
+  // right, then back along the ground
+  QPolygonF run;
+  int runStart = -1;
+  for (int c = begin; c <= end; ++c) {
+    if (c < end && m_depth[c] >= kVisibleDepth) {
+      if (runStart < 0)
+        runStart = c;
+      run.append(QPointF(c, m_surface[c]));
+      run.append(QPointF(c + 1, m_surface[c]));
+      continue;
+    }
+    if (runStart < 0)
+      continue;
+    for (int k = c - 1; k >= runStart; --k) {
+      run.append(QPointF(k + 1, m_ground[k] + 1));
+      run.append(QPointF(k, m_ground[k] + 1));
+    }
+    painter.drawPolygon(run);
+    run.clear();
+    runStart = -1;
+  }
+  painter.restore();
+}
@@ -0,0 +1,50 @@
+#ifndef SNOWCOVER_H
+#define SNOWCOVER_H
+
+#include <QRect>
+#include <QVector>
+
+class QPainter;
+class TreeMask;
+
+// Snow settled on the tree and the gift floor, kept as a depth per pixel
+// column on top of a ground line: the tree's upper outline where there is
+// tree, the floor elsewhere. How much a column can hold comes from the slope
+// of the tree's distance field there, so ledges and the floor collect snow
+// while steep tier sides shed it. Deposits and melting only mark the columns
+// they touch, and only that span is repainted.
+class SnowCover {
+public:
+  void build(const TreeMask &mask, float floorY);
+  void clear();
+
+  // Settles a flake of radius `size` centred on column `x`
+  void deposit(float x, float size);
+  // Melts a little, in coarse steps so idle snow is not repainted per frame
+  void melt(float dt);
+  // Whether any column still holds snow, so melting needs frames
+  bool hasSnow() const { return m_hasSnow; }
+
+  // Ground minus snow per column; changes bump revision()
+  const QVector<float> &surface() const { return m_surface; }
+  int revision() const { return m_revision; }
+
+  // Area that changed since the last call, null if none
+  QRect takeDirty();
+  void draw(QPainter &painter, const QRect &clip) const;
+
+private:
+  void touch(int begin, int end);
+
+  QVector<float> m_ground;   // Top of tree or floor per column
+  QVector<float> m_capacity; // Deepest snow the column holds
+  QVector<float> m_depth;
+  QVector<float> m_surface;
+  int m_dirtyBegin = 0; // Column span [begin, end) awaiting a repaint
+  int m_dirtyEnd = 0;
+  int m_revision = 0;
+  float m_meltClock = 0;
+  bool m_hasSnow = false;
+};
+
+#endif // SNOWCOVER_H
@@ -0,0 +1,106 @@
+#ifndef SNOWLAYERS_H
+#define SNOWLAYERS_H
+
+#include "snowsimulation.h"
+#include <QPainter>
+#include <cmath>
+
+// Snow layer policies. A layer is a type whose constants are folded into
+// SnowLayerSimulation's spawn and draw loops at compile time, so the loops
+// carry no per-flake layer checks and the painter state is set once per
+// frame. A new layer (say a mid-depth parallax band) is one more struct.
+//
+// Speeds are in pixels per 33 ms reference tick, sizes are radii in pixels
+// and drift is the peak sideways sway per tick. Settling layers come to rest
+// on the collider (the snow cover) instead of falling through it.
+struct BackSnowLayer {
+  static constexpr const char *kName = "snow.back";
+  static constexpr const char *kStepScope = "snow.back.step";
+  static constexpr float kMinSpeed = 0.3f, kMaxSpeed = 0.8f; // Slower
+  static constexpr float kMinSize = 1.0f, kMaxSize = 2.5f;   // Smaller
+  static constexpr float kMaxDrift = 1.5f;
+  static constexpr float kOpacity = 0.4f;
+  static constexpr bool kSettles = false; // Behind the tree
+};
+
+struct FrontSnowLayer {
+  static constexpr const char *kName = "snow.front";
+  static constexpr const char *kStepScope = "snow.front.step";
+  static constexpr float kMinSpeed = 1.2f, kMaxSpeed = 3.7f; // Faster
+  static constexpr float kMinSize = 3.0f, kMaxSize = 6.0f;   // Larger
+  static constexpr float kMaxDrift = 1.5f;
+  static constexpr float kOpacity = 0.9f;
+  static constexpr bool kSettles = true;
+};
+
+template <typename Layer>
+class SnowLayerSimulation final : public SnowSimulation {
+public:
+  SnowLayerSimulation(int width, int height)
+      : SnowSimulation(Layer::kName, Layer::kStepScope, Layer::kOpacity, width,
+                       height) {}
+  // The running job may still call into this layer's overrides
+  ~SnowLayerSimulation() override { waitForIdle(); }
+
+protected:
+  void spawn(int count) override {
+    constexpr float speedRange = Layer::kMaxSpeed - Layer::kMinSpeed;
+    constexpr float sizeRange = Layer::kMaxSize - Layer::kMinSize;
+    for (int i = 0; i < count; ++i) {
+      float x = m_rng.bounded(m_width);
+      float y = m_rng.bounded(m_height);
+      float speed = Layer::kMinSpeed + m_rng.generateDouble() * speedRange;
+      float size = Layer::kMinSize + m_rng.generateDouble() * sizeRange;
+      float drift = m_rng.generateDouble() * Layer::kMaxDrift;
+      float phase = m_rng.generateDouble() * 2.0f * M_PI;
+      m_particles.append(x, y, speed, drift, phase, size);
+    }
+  }
+
+  void settle(float ticks) override {
+    if constexpr (Layer::kSettles) {
+      const Collider &target = collider();
+      const int columns = target.surface.size();
+      if (columns == 0)
+        return;
+      // A flake lands when its lower edge crossed the surface during this
+      // step: it is now at most its own fall below it. Steps coalesced under
+      // load fall further, so the band grows with them. Flakes deeper down
+      // were spawned there and pass in front. The radius is slack for the
+      // sideways sway onto a higher column.
+      float *x = m_particles.x();
+      float *y = m_particles.y();
+      const float *size = m_particles.sizes();
+      const float *speed = m_particles.speeds();
+      const float left = target.origin.x();
+      const float top = target.origin.y();
+      m_settled.clear();
+      for (int i = 0, n = m_particles.size(); i < n; ++i) {
+        int column = static_cast<int>(x[i] - left);
+        if (column < 0 || column >= columns)
+          continue;
+        float below = y[i] + size[i] - (top + target.surface[column]);
+        if (below < 0 || below > speed[i] * ticks + size[i])
+          continue;
+        m_settled.append({x[i] - left, size[i]});
+        y[i] = m_height + 1.0f; // Respawned at the top by the step
+      }
+      if (!m_settled.isEmpty())
+        reportLandings(m_settled);
+    }
+  }
+
+  void paint(QPainter &painter) override {
+    const float *x = m_particles.x();
+    const float *y = m_particles.y();
+    const float *size = m_particles.sizes();
+    painter.setOpacity(Layer::kOpacity);
+    for (int i = 0, n = m_particles.size(); i < n; ++i)
+      painter.drawEllipse(QPointF(x[i], y[i]), size[i], size[i]);
+  }
+
+private:
+  QVector<SnowLanding> m_settled; // Worker side, reused every step
+};
+
+#endif // SNOWLAYERS_H
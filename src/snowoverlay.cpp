@@ -1,19 +1,27 @@
 #include "snowoverlay.h"
+#include "frameclock.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include "snowlayers.h"
 #include <QApplication>
 #include <QPainter>
-#include <QRandomGenerator>
 #include <QScreen>
-#include <cmath>
+#include <algorithm>
 
 SnowOverlay::SnowOverlay(bool isForeground, QWidget *parent)
     : QWidget(parent), m_isForeground(isForeground) {
-  // Disable window shadows to prevent "ghost" snow artifacts
-  setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool |
-                 Qt::WindowTransparentForInput | Qt::WindowDoesNotAcceptFocus |
-                 Qt::NoDropShadowWindowHint);
+  if (parent) {
+    // Layer inside a composited scene window
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+  } else {
+    // Disable window shadows to prevent "ghost" snow artifacts
+    setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
+                   Qt::Tool | Qt::WindowTransparentForInput |
+                   Qt::WindowDoesNotAcceptFocus | Qt::NoDropShadowWindowHint);
 
-  setAttribute(Qt::WA_TranslucentBackground);
-  setAttribute(Qt::WA_ShowWithoutActivating);
+    setAttribute(Qt::WA_TranslucentBackground);
+    setAttribute(Qt::WA_ShowWithoutActivating);
+  }
 
   QScreen *screen = QApplication::primaryScreen();
   QRect geom = screen->geometry();
@@ -21,73 +29,82 @@ SnowOverlay::SnowOverlay(bool isForeground, QWidget *parent)
   m_screenHeight = geom.height();
   setFixedSize(m_screenWidth, m_screenHeight);
 
-  addSnowflakes(200);
+  if (m_isForeground)
+    m_simulation = new SnowLayerSimulation<FrontSnowLayer>(m_screenWidth,
+                                                           m_screenHeight);
+  else
+    m_simulation = new SnowLayerSimulation<BackSnowLayer>(m_screenWidth,
+                                                          m_screenHeight);
+  applyQuality();
+  connect(QualityGovernor::instance(), &QualityGovernor::qualityChanged, this,
+          &SnowOverlay::applyQuality);
 
-  m_timer = new QTimer(this);
-  connect(m_timer, &QTimer::timeout, this, &SnowOverlay::updateSnow);
-  m_timer->start(33);
+  // The clock only steps layers that are on screen
+  FrameClock::instance()->registerSource(
+      this, [this]() { return m_simulation->flakeCount() > 0; },
+      [this](float dt) { updateSnow(dt); });
 }
 
-void SnowOverlay::addSnowflakes(int count) {
-  auto *gen = QRandomGenerator::global();
-  for (int i = 0; i < count; ++i) {
-    Snowflake s;
-    s.pos = QPointF(gen->bounded(m_screenWidth), gen->bounded(m_screenHeight));
-
-    if (m_isForeground) {
-      s.speed = 1.2f + gen->generateDouble() * 2.5f; // Faster
-      s.size = 3.0f + gen->generateDouble() * 3.0f;  // Larger
-    } else {
-      s.speed = 0.3f + gen->generateDouble() * 0.5f; // Slower
-      s.size = 1.0f + gen->generateDouble() * 1.5f;  // Smaller
-    }
-
-    s.drift = gen->generateDouble() * 1.5f;
-    s.driftPhase = gen->generateDouble() * 2.0f * M_PI;
-    m_snowflakes.append(s);
-  }
-}
+SnowOverlay::~SnowOverlay() { delete m_simulation; }
 
 void SnowOverlay::changeSnowIntensity(int delta) {
-  if (delta > 0) {
-    addSnowflakes(delta);
-  } else if (delta < 0) {
-    int toRemove = std::min(-delta, static_cast<int>(m_snowflakes.size()));
-    for (int i = 0; i < toRemove; ++i) {
-      if (!m_snowflakes.isEmpty())
-        m_snowflakes.removeLast();
-    }
-  }
+  setSnowflakeCount(m_requestedFlakes + delta);
 }
 
-void SnowOverlay::updateSnow() {
-  auto *gen = QRandomGenerator::global();
-  for (auto &s : m_snowflakes) {
-    s.pos.ry() += s.speed;
-    s.driftPhase += 0.05f;
-    s.pos.rx() += std::sin(s.driftPhase) * s.drift;
-
-    if (s.pos.y() > m_screenHeight) {
-      s.pos.setY(-20); // Spawn further up
-      s.pos.setX(gen->bounded(m_screenWidth));
-    }
-  }
+void SnowOverlay::setSnowflakeCount(int count) {
+  m_requestedFlakes = std::max(0, count);
+  applyQuality();
+  FrameClock::instance()->wake();
+}
+
+void SnowOverlay::applyQuality() {
+  QualityGovernor *governor = QualityGovernor::instance();
+  m_simulation->setFlakeCount(governor->effectiveFlakes(m_requestedFlakes));
+  m_simulation->setAntialiasing(governor->quality().antialiasing);
+}
+
+void SnowOverlay::setSnowArea(const QRect &area) {
+  m_screenWidth = area.width();
+  m_screenHeight = area.height();
+  setFixedSize(area.size());
+  move(area.topLeft());
+  m_simulation->setArea(m_screenWidth, m_screenHeight);
+}
+
+void SnowOverlay::setRenderBackend(SnowRenderBackend backend) {
+  m_simulation->setBackend(backend);
+  update();
+}
+
+void SnowOverlay::updateSnow(float dt) {
+  ProfileScope scope(m_isForeground ? "snow.front.update"
+                                    : "snow.back.update");
+
+  // Step and rasterization run on the snow pool; paintEvent() blits whichever
+  // frame is newest by then
+  m_simulation->setDevicePixelRatio(devicePixelRatioF());
+  m_simulation->requestStep(dt);
   update();
 }
 
 void SnowOverlay::paintEvent(QPaintEvent *) {
+  ProfileScope scope(m_isForeground ? "snow.front.paint"
+                                    : "snow.back.paint");
+  FrameCostScope cost;
   QPainter painter(this);
-  // Definitive clear to prevent ghosting
-  painter.setCompositionMode(QPainter::CompositionMode_Source);
-  painter.fillRect(rect(), Qt::transparent);
-  painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-
-  painter.setRenderHint(QPainter::Antialiasing);
-  painter.setPen(Qt::NoPen);
-  painter.setBrush(Qt::white);
+  const QImage &frame = m_simulation->latest();
 
-  for (const auto &s : m_snowflakes) {
-    painter.setOpacity(m_isForeground ? 0.9 : 0.4);
-    painter.drawEllipse(s.pos, s.size, s.size);
+  if (!isWindow()) {
+    // Composited over the layers below us in a shared backing store
+    if (!frame.isNull())
+      painter.drawImage(0, 0, frame);
+    return;
   }
+
+  // Source mode doubles as the clear, so the frame is a single blit
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  if (frame.isNull())
+    painter.fillRect(rect(), Qt::transparent);
+  else
+    painter.drawImage(0, 0, frame);
 }
@@ -1,39 +1,44 @@
 #ifndef SNOWOVERLAY_H
 #define SNOWOVERLAY_H
 
-#include <QPointF>
-#include <QTimer>
-#include <QVector>
+#include "snowsimulation.h"
 #include <QWidget>
 
-struct Snowflake {
-  QPointF pos;
-  float speed;
-  float drift;
-  float driftPhase;
-  float size;
-};
-
 class SnowOverlay : public QWidget {
   Q_OBJECT
 public:
   explicit SnowOverlay(bool isForeground, QWidget *parent = nullptr);
+  ~SnowOverlay() override;
   void changeSnowIntensity(int delta);
+  void setSnowflakeCount(int count);
+  // Covers `area` (global logical coordinates) instead of the default
+  // column on the primary screen.
+  void setSnowArea(const QRect &area);
+  void setRenderBackend(SnowRenderBackend backend);
+  // Flakes asked for; the quality governor may simulate fewer
+  int snowflakeCount() const { return m_requestedFlakes; }
+  // Front layers land flakes on `surface`; see SnowSimulation::setCollider
+  void setCollider(const QVector<float> &surface, const QPointF &origin) {
+    m_simulation->setCollider(surface, origin);
+  }
+  void takeLandings(QVector<SnowLanding> &out) {
+    m_simulation->takeLandings(out);
+  }
 
 protected:
   void paintEvent(QPaintEvent *event) override;
 
-private slots:
-  void updateSnow();
+public slots:
+  void updateSnow(float dt);
 
 private:
-  void addSnowflakes(int count);
+  void applyQuality();
 
   bool m_isForeground;
   int m_screenWidth;
   int m_screenHeight;
-  QVector<Snowflake> m_snowflakes;
-  QTimer *m_timer;
+  int m_requestedFlakes = 200;
+  SnowSimulation *m_simulation; // Steps and rasterizes off the GUI thread
 };
 
 #endif // SNOWOVERLAY_H
@@ -0,0 +1,120 @@
+#include "snowparticles.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SNOW_USE_SSE2 1
+#endif
+
+namespace {
+constexpr float kPi = 3.14159265f;
+constexpr float kTwoPi = 2.0f * kPi;
+constexpr float kPhaseStep = 0.05f;
+
+// Parabolic sine approximation, valid on [-pi, pi]. Max error ~0.001, which is
+// invisible at drift amplitudes of at most 1.5px.
+constexpr float kSinB = 4.0f / kPi;
+constexpr float kSinC = -4.0f / (kPi * kPi);
+constexpr float kSinP = 0.225f;
+
+inline float fastSin(float x) {
+  float y = kSinB * x + kSinC * x * std::fabs(x);
+  return kSinP * (y * std::fabs(y) - y) + y;
+}
+
+inline float wrapPhase(float phase) {
+  phase = std::fmod(phase + kPi, kTwoPi);
+  if (phase < 0)
+    phase += kTwoPi;
+  return phase - kPi;
+}
+} // namespace
+
+void SnowParticles::append(float x, float y, float speed, float drift,
+                           float phase, float size) {
+  m_x.append(x);
+  m_y.append(y);
+  m_speed.append(speed);
+  m_drift.append(drift);
+  m_phase.append(wrapPhase(phase));
+  m_size.append(size);
+}
+
+void SnowParticles::removeLast(int count) {
+  int newSize = std::max(0, size() - count);
+  m_x.resize(newSize);
+  m_y.resize(newSize);
+  m_speed.resize(newSize);
+  m_drift.resize(newSize);
+  m_phase.resize(newSize);
+  m_size.resize(newSize);
+}
+
+void SnowParticles::clear() { removeLast(size()); }
+
+void SnowParticles::update(float ticks) {
+  int n = size();
+  int i = 0;
+
+#ifdef SNOW_USE_SSE2
+  float *px = m_x.data();
+  float *py = m_y.data();
+  float *pphase = m_phase.data();
+  const float *pspeed = m_speed.constData();
+  const float *pdrift = m_drift.constData();
+
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 t = _mm_set1_ps(ticks);
+  const __m128 step = _mm_set1_ps(kPhaseStep * ticks);
+  const __m128 pi = _mm_set1_ps(kPi);
+  const __m128 twoPi = _mm_set1_ps(kTwoPi);
+  const __m128 sinB = _mm_set1_ps(kSinB);
+  const __m128 sinC = _mm_set1_ps(kSinC);
+  const __m128 sinP = _mm_set1_ps(kSinP);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 y = _mm_loadu_ps(py + i);
+    __m128 fall = _mm_mul_ps(_mm_loadu_ps(pspeed + i), t);
+    _mm_storeu_ps(py + i, _mm_add_ps(y, fall));
+
+    __m128 phase = _mm_add_ps(_mm_loadu_ps(pphase + i), step);
+    __m128 wrap = _mm_cmpge_ps(phase, pi);
+    phase = _mm_sub_ps(phase, _mm_and_ps(wrap, twoPi));
+    _mm_storeu_ps(pphase + i, phase);
+
+    __m128 s = _mm_add_ps(
+        _mm_mul_ps(sinB, phase),
+        _mm_mul_ps(_mm_mul_ps(sinC, phase), _mm_and_ps(phase, absMask)));
+    s = _mm_add_ps(
+        _mm_mul_ps(sinP,
+                   _mm_sub_ps(_mm_mul_ps(s, _mm_and_ps(s, absMask)), s)),
+        s);
+
+    __m128 x = _mm_loadu_ps(px + i);
+    __m128 sway = _mm_mul_ps(_mm_mul_ps(s, _mm_loadu_ps(pdrift + i)), t);
+    _mm_storeu_ps(px + i, _mm_add_ps(x, sway));
+  }
+#endif
+
+  updateScalar(i, n, ticks);
+}
+
+// Fallback for targets without SSE2 (e.g. arm64) and for the tail of the SSE
+// loop. Written branch-light so compilers can auto-vectorize it.
+void SnowParticles::updateScalar(int begin, int end, float ticks) {
+  float *px = m_x.data();
+  float *py = m_y.data();
+  float *pphase = m_phase.data();
+  const float *pspeed = m_speed.constData();
+  const float *pdrift = m_drift.constData();
+  const float step = kPhaseStep * ticks;
+
+  for (int i = begin; i < end; ++i) {
+    py[i] += pspeed[i] * ticks;
+    float phase = pphase[i] + step;
+    phase -= (phase >= kPi) ? kTwoPi : 0.0f;
+    pphase[i] = phase;
+    px[i] += fastSin(phase) * pdrift[i] * ticks;
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef SNOWPARTICLES_H
+#define SNOWPARTICLES_H
+
+#include <QVector>
+
+// Structure-of-arrays store for the flakes of one snow layer. Every attribute
+// lives in its own contiguous float array so the update kernel can stream
+// through them four (SSE) lanes at a time.
+class SnowParticles {
+public:
+  int size() const { return m_x.size(); }
+  bool isEmpty() const { return m_x.isEmpty(); }
+
+  void append(float x, float y, float speed, float drift, float phase,
+              float size);
+  void removeLast(int count);
+  void clear();
+
+  // Advances the layer by `ticks` reference ticks (fractional for
+  // time-based stepping): fall by speed, advance the drift phase and sway
+  // sideways. Phases are kept wrapped to [-pi, pi) for the fast sine.
+  void update(float ticks);
+
+  const float *x() const { return m_x.constData(); }
+  const float *y() const { return m_y.constData(); }
+  const float *sizes() const { return m_size.constData(); }
+  const float *speeds() const { return m_speed.constData(); } // Per tick
+  float *x() { return m_x.data(); }
+  float *y() { return m_y.data(); }
+
+private:
+  void updateScalar(int begin, int end, float ticks);
+
+  QVector<float> m_x;
+  QVector<float> m_y;
+  QVector<float> m_speed;
+  QVector<float> m_drift;
+  QVector<float> m_phase;
+  QVector<float> m_size;
+};
+
+#endif // SNOWPARTICLES_H
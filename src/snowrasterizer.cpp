@@ -0,0 +1,160 @@
+#include "snowrasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SNOW_USE_SSE2 1
+#endif
+
+namespace {
+constexpr int kRadiusSteps = 4; // quarter pixel radius quantization
+constexpr int kSubSteps = 4;    // quarter pixel centre quantization
+constexpr int kSupersample = 8; // 8x8 samples per pixel when building masks
+
+inline quint32 blendPixel(quint32 dst, uint a) {
+  // Source is premultiplied white, so every channel gets the same formula:
+  // c' = a + c * (255 - a) / 255
+  uint inv = 255 - a;
+  quint32 out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    uint t = ((dst >> shift) & 0xff) * inv + 128;
+    t = (t + (t >> 8)) >> 8;
+    out |= (t + a) << shift;
+  }
+  return out;
+}
+
+void blendRow(quint32 *dst, const quint8 *alpha, int count) {
+  int i = 0;
+#ifdef SNOW_USE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(255);
+  const __m128i half = _mm_set1_epi16(128);
+  for (; i + 4 <= count; i += 4) {
+    quint32 a4;
+    std::memcpy(&a4, alpha + i, 4);
+    if (a4 == 0)
+      continue;
+    // Broadcast each coverage byte to the four channels of its pixel
+    __m128i a = _mm_cvtsi32_si128(static_cast<int>(a4));
+    a = _mm_unpacklo_epi8(a, a);
+    a = _mm_unpacklo_epi16(a, a);
+
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i aLo = _mm_unpacklo_epi8(a, zero);
+    __m128i aHi = _mm_unpackhi_epi8(a, zero);
+    __m128i dLo = _mm_unpacklo_epi8(d, zero);
+    __m128i dHi = _mm_unpackhi_epi8(d, zero);
+
+    __m128i tLo = _mm_add_epi16(_mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo)),
+                                half);
+    __m128i tHi = _mm_add_epi16(_mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi)),
+                                half);
+    tLo = _mm_srli_epi16(_mm_add_epi16(tLo, _mm_srli_epi16(tLo, 8)), 8);
+    tHi = _mm_srli_epi16(_mm_add_epi16(tHi, _mm_srli_epi16(tHi, 8)), 8);
+
+    __m128i out = _mm_packus_epi16(_mm_add_epi16(tLo, aLo),
+                                   _mm_add_epi16(tHi, aHi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), out);
+  }
+#endif
+  for (; i < count; ++i) {
+    if (alpha[i])
+      dst[i] = blendPixel(dst[i], alpha[i]);
+  }
+}
+} // namespace
+
+SnowRasterizer::SnowRasterizer(float opacity) : m_opacity(opacity) {}
+
+void SnowRasterizer::begin(QImage &target, const QSize &size, qreal dpr) {
+  QSize pixelSize = (QSizeF(size) * dpr).toSize();
+  if (target.size() != pixelSize ||
+      target.format() != QImage::Format_ARGB32_Premultiplied) {
+    target = QImage(pixelSize, QImage::Format_ARGB32_Premultiplied);
+  }
+  target.setDevicePixelRatio(dpr);
+  target.fill(Qt::transparent);
+  m_dpr = dpr;
+}
+
+const SnowRasterizer::Kernel &SnowRasterizer::kernel(int radiusQ, int subX,
+                                                     int subY) {
+  int key = (radiusQ * kSubSteps + subY) * kSubSteps + subX;
+  auto it = m_kernels.find(key);
+  if (it != m_kernels.end())
+    return *it;
+
+  Kernel k;
+  float r = static_cast<float>(radiusQ) / kRadiusSteps;
+  k.extent = static_cast<int>(std::ceil(r)) + 1;
+  k.offset = m_coverage.size();
+
+  // Centre inside the pixel (0, 0) at the middle of its quantization bin
+  float cx = (subX + 0.5f) / kSubSteps;
+  float cy = (subY + 0.5f) / kSubSteps;
+  float r2 = r * r;
+  int dim = 2 * k.extent + 1;
+  m_coverage.resize(k.offset + dim * dim);
+  quint8 *mask = m_coverage.data() + k.offset;
+
+  for (int py = 0; py < dim; ++py) {
+    for (int px = 0; px < dim; ++px) {
+      int inside = 0;
+      for (int sy = 0; sy < kSupersample; ++sy) {
+        float dy = (py - k.extent) + (sy + 0.5f) / kSupersample - cy;
+        for (int sx = 0; sx < kSupersample; ++sx) {
+          float dx = (px - k.extent) + (sx + 0.5f) / kSupersample - cx;
+          inside += (dx * dx + dy * dy <= r2);
+        }
+      }
+      float coverage =
+          static_cast<float>(inside) / (kSupersample * kSupersample);
+      mask[py * dim + px] =
+          static_cast<quint8>(std::lround(coverage * m_opacity * 255.0f));
+    }
+  }
+
+  return *m_kernels.insert(key, k);
+}
+
+void SnowRasterizer::splat(QImage &target, float x, float y, float radius) {
+  x *= m_dpr;
+  y *= m_dpr;
+  radius *= m_dpr;
+
+  float fx = std::floor(x);
+  float fy = std::floor(y);
+  int ix = static_cast<int>(fx);
+  int iy = static_cast<int>(fy);
+  int subX = std::min(kSubSteps - 1, static_cast<int>((x - fx) * kSubSteps));
+  int subY = std::min(kSubSteps - 1, static_cast<int>((y - fy) * kSubSteps));
+  int radiusQ =
+      std::max(1, static_cast<int>(std::lround(radius * kRadiusSteps)));
+
+  const Kernel &k = kernel(radiusQ, subX, subY);
+  int dim = 2 * k.extent + 1;
+  int left = ix - k.extent;
+  int top = iy - k.extent;
+
+  int x0 = std::max(0, left);
+  int y0 = std::max(0, top);
+  int x1 = std::min(target.width(), left + dim);
+  int y1 = std::min(target.height(), top + dim);
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  const quint8 *mask = m_coverage.constData() + k.offset;
+  for (int row = y0; row < y1; ++row) {
+    auto *dst = reinterpret_cast<quint32 *>(target.scanLine(row));
+    blendRow(dst + x0, mask + (row - top) * dim + (x0 - left), x1 - x0);
+  }
+}
+
+void SnowRasterizer::splat(QImage &target, const float *x, const float *y,
+                           const float *radius, int count) {
+  for (int i = 0; i < count; ++i)
+    splat(target, x[i], y[i], radius[i]);
+}
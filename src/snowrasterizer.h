@@ -0,0 +1,38 @@
+#ifndef SNOWRASTERIZER_H
+#define SNOWRASTERIZER_H
+
+#include <QHash>
+#include <QImage>
+#include <QVector>
+
+// Software splatter that writes white snowflake discs straight into a
+// premultiplied ARGB32 image. Coverage masks are precomputed per quantized
+// radius (quarter pixel) and sub-pixel centre offset, and blended with SSE2
+// where available, so a flake costs a few row blends instead of a QPainter
+// path fill.
+class SnowRasterizer {
+public:
+  explicit SnowRasterizer(float opacity = 1.0f);
+
+  // Clears the target to transparent and prepares it for the given logical
+  // size and device pixel ratio.
+  void begin(QImage &target, const QSize &size, qreal dpr);
+  void splat(QImage &target, float x, float y, float radius);
+  void splat(QImage &target, const float *x, const float *y,
+             const float *radius, int count);
+
+private:
+  struct Kernel {
+    int offset = -1; // into m_coverage
+    int extent = 0;  // half width in pixels, mask is (2 * extent + 1)^2
+  };
+
+  const Kernel &kernel(int radiusQ, int subX, int subY);
+
+  float m_opacity;
+  qreal m_dpr = 1.0;
+  QHash<int, Kernel> m_kernels;
+  QVector<quint8> m_coverage;
+};
+
+#endif // SNOWRASTERIZER_H
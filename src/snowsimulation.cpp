@@ -0,0 +1,183 @@
+#include "snowsimulation.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include <QCoreApplication>
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Flake speeds and drift are tuned per tick of the original 33 ms timer
+constexpr float kTickSeconds = 0.033f;
+
+// Landings kept for the GUI before new ones are dropped
+constexpr int kMaxPendingLandings = 4096;
+
+bool s_threaded = true;
+} // namespace
+
+void SnowSimulation::setThreaded(bool threaded) { s_threaded = threaded; }
+
+bool SnowSimulation::isThreaded() { return s_threaded; }
+
+QThreadPool *SnowSimulation::pool() {
+  // A private pool so waiting for snow jobs never waits on unrelated work
+  static QThreadPool *pool = [] {
+    auto *p = new QThreadPool(qApp);
+    p->setObjectName("SnowSimulation");
+    p->setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));
+    return p;
+  }();
+  return pool;
+}
+
+SnowSimulation::SnowSimulation(const char *name, const char *stepScope,
+                               float opacity, int width, int height)
+    : m_width(width), m_height(height), m_rng(Rng::forSubsystem(name)),
+      m_stepScope(stepScope), m_rasterizer(opacity), m_areaWidth(width),
+      m_areaHeight(height) {}
+
+SnowSimulation::~SnowSimulation() { waitForIdle(); }
+
+void SnowSimulation::waitForIdle() {
+  // Only this layer's job; the other layers keep the shared pool busy and
+  // are not waited on. A job is one step or a few, so yielding is brief.
+  while (m_jobs.load(std::memory_order_acquire) > 0)
+    QThread::yieldCurrentThread();
+}
+
+void SnowSimulation::requestStep(float dt) {
+  m_pendingNs.fetch_add(static_cast<qint64>(dt * 1e9f));
+  if (!s_threaded) {
+    step();
+    return;
+  }
+  m_requests.fetch_add(1);
+  if (!m_busy.exchange(true)) {
+    m_jobs.fetch_add(1);
+    pool()->start([this]() { run(); });
+  }
+}
+
+void SnowSimulation::setFlakeCount(int count) {
+  m_targetCount.store(std::max(0, count));
+  requestStep(0);
+}
+
+void SnowSimulation::setAntialiasing(bool enabled) {
+  m_antialiasing.store(enabled);
+  requestStep(0);
+}
+
+void SnowSimulation::setBackend(SnowRenderBackend backend) {
+  m_backend.store(int(backend));
+  requestStep(0);
+}
+
+void SnowSimulation::setArea(int width, int height) {
+  m_areaWidth.store(width);
+  m_areaHeight.store(height);
+  requestStep(0);
+}
+
+void SnowSimulation::setCollider(const QVector<float> &surface,
+                                 const QPointF &origin) {
+  Collider &next = m_colliders.writeBuffer();
+  next.surface = surface;
+  next.origin = origin;
+  m_colliders.publish();
+}
+
+void SnowSimulation::takeLandings(QVector<SnowLanding> &out) {
+  QMutexLocker locker(&m_landingMutex);
+  out += m_landings;
+  m_landings.clear();
+}
+
+void SnowSimulation::reportLandings(const QVector<SnowLanding> &landings) {
+  QMutexLocker locker(&m_landingMutex);
+  for (const SnowLanding &landing : landings) {
+    if (m_landings.size() >= kMaxPendingLandings)
+      break; // Nobody is collecting them
+    m_landings.append(landing);
+  }
+}
+
+void SnowSimulation::run() {
+  // Requests that arrive while a step runs fold into one more step rather
+  // than queueing a backlog. Re-acquiring m_busy after releasing it closes
+  // the window where the GUI saw us busy but we had already finished.
+  for (;;) {
+    m_requests.store(0);
+    step();
+    m_busy.store(false);
+    if (m_requests.load() == 0 || m_busy.exchange(true))
+      break;
+  }
+  // Last touch of the layer: once the count drops, waitForIdle() returns
+  // and the layer may be destroyed
+  m_jobs.fetch_sub(1, std::memory_order_release);
+}
+
+void SnowSimulation::step() {
+  ProfileScope scope(m_stepScope);
+  FrameCostScope cost;
+  float dt = m_pendingNs.exchange(0) / 1e9f;
+
+  int width = m_areaWidth.load();
+  int height = m_areaHeight.load();
+  if (width != m_width || height != m_height) {
+    m_width = width;
+    m_height = height;
+    m_particles.clear(); // refilled below at the current density
+  }
+
+  int target = m_targetCount.load();
+  if (target != m_particles.size())
+    applyFlakeCount(target);
+
+  const float ticks = dt / kTickSeconds;
+  m_particles.update(ticks);
+  settle(ticks);
+
+  // Respawn pass: only flakes that left the bottom edge touch the generator
+  float *x = m_particles.x();
+  float *y = m_particles.y();
+  const float bottom = m_height;
+  for (int i = 0, n = m_particles.size(); i < n; ++i) {
+    if (y[i] > bottom) {
+      y[i] = -20; // Spawn further up
+      x[i] = m_rng.bounded(m_width);
+    }
+  }
+
+  render(m_frames.writeBuffer());
+  m_frames.publish();
+}
+
+void SnowSimulation::applyFlakeCount(int count) {
+  if (count < m_particles.size())
+    m_particles.removeLast(m_particles.size() - count);
+  else
+    spawn(count - m_particles.size());
+}
+
+void SnowSimulation::render(QImage &frame) {
+  // begin() reuses the ring image when its size and ratio still match
+  m_rasterizer.begin(frame, QSize(m_width, m_height), m_dpr.load());
+
+  if (SnowRenderBackend(m_backend.load()) == SnowRenderBackend::Splat) {
+    const SnowParticles &flakes = m_particles;
+    m_rasterizer.splat(frame, flakes.x(), flakes.y(), flakes.sizes(),
+                       flakes.size());
+    return;
+  }
+
+  QPainter painter(&frame);
+  painter.setRenderHint(QPainter::Antialiasing, m_antialiasing.load());
+  painter.setPen(Qt::NoPen);
+  painter.setBrush(Qt::white);
+  paint(painter);
+}
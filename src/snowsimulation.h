@@ -0,0 +1,118 @@
+#ifndef SNOWSIMULATION_H
+#define SNOWSIMULATION_H
+
+#include "rng.h"
+#include "snowparticles.h"
+#include "snowrasterizer.h"
+#include "triplebuffer.h"
+#include <QImage>
+#include <QMutex>
+#include <QPointF>
+#include <QVector>
+#include <atomic>
+
+class QPainter;
+class QThreadPool;
+
+enum class SnowRenderBackend { Painter, Splat };
+
+// A flake that came to rest on a collider, in collider columns
+struct SnowLanding {
+  float x;
+  float size;
+};
+
+// Simulation and rasterization of one snow layer. Steps run as jobs on a
+// shared thread pool, one job per layer at a time, so the front and back
+// layers fill separate cores. The GUI thread only posts time steps and
+// settings through atomics and blits the newest finished frame from a ring
+// of three images, so neither side ever waits for the other.
+//
+// Everything that differs between layers (flake ranges, opacity) lives in
+// SnowLayerSimulation<Layer>, see snowlayers.h.
+class SnowSimulation {
+public:
+  virtual ~SnowSimulation();
+
+  // GUI thread. Accumulates dt and starts a step unless one is running.
+  void requestStep(float dt);
+  void setFlakeCount(int count);
+  int flakeCount() const { return m_targetCount.load(); }
+  void setBackend(SnowRenderBackend backend);
+  // Painter backend only; splats are always smooth
+  void setAntialiasing(bool enabled);
+  // Resizes the layer; flakes are reseeded over the new area.
+  void setArea(int width, int height);
+  void setDevicePixelRatio(qreal dpr) { m_dpr.store(dpr); }
+  // Newest finished frame, null until the first step; GUI thread only.
+  const QImage &latest() { return m_frames.read(); }
+
+  // GUI thread. Surface heights, one per column, that settling layers land
+  // on; column 0 sits at `origin` in layer coordinates. Empty disables.
+  void setCollider(const QVector<float> &surface, const QPointF &origin);
+  // GUI thread. Moves the landings since the last call to the end of `out`.
+  void takeLandings(QVector<SnowLanding> &out);
+
+  // Runs steps inline on the caller's thread instead (benchmarks).
+  // Must be set before the first SnowSimulation is created.
+  static void setThreaded(bool threaded);
+  static bool isThreaded();
+
+protected:
+  // `name` selects the random stream, `stepScope` labels the profiler scope
+  SnowSimulation(const char *name, const char *stepScope, float opacity,
+                 int width, int height);
+  // Blocks until this layer has no job queued or running; layers call it
+  // before they go away
+  void waitForIdle();
+
+  // Worker side. Appends `count` new flakes anywhere in the area.
+  virtual void spawn(int count) = 0;
+  // Painter backend: draws every flake into a cleared frame
+  virtual void paint(QPainter &painter) = 0;
+  // Worker side, after each move, with the reference ticks it covered.
+  // Layers that settle send flakes that reached the collider below the
+  // bottom edge so they respawn.
+  virtual void settle(float) {}
+
+  struct Collider {
+    QVector<float> surface;
+    QPointF origin;
+  };
+  // Worker side
+  const Collider &collider() { return m_colliders.read(); }
+  void reportLandings(const QVector<SnowLanding> &landings);
+
+  // Worker side, touched only by the running job
+  int m_width;
+  int m_height;
+  SnowParticles m_particles;
+  Rng m_rng;
+
+private:
+  static QThreadPool *pool();
+  void run();
+  void step();
+  void applyFlakeCount(int count);
+  void render(QImage &frame);
+
+  const char *m_stepScope;
+  SnowRasterizer m_rasterizer;
+
+  std::atomic<qint64> m_pendingNs{0};
+  std::atomic<int> m_requests{0};
+  std::atomic<bool> m_busy{false};
+  std::atomic<int> m_jobs{0}; // Queued or running jobs of this layer
+  std::atomic<int> m_targetCount{0};
+  std::atomic<int> m_backend{int(SnowRenderBackend::Painter)};
+  std::atomic<bool> m_antialiasing{true};
+  std::atomic<double> m_dpr{1.0};
+  std::atomic<int> m_areaWidth;
+  std::atomic<int> m_areaHeight;
+  TripleBuffer<QImage> m_frames;
+  TripleBuffer<Collider> m_colliders;
+  QMutex m_landingMutex;
+  QVector<SnowLanding> m_landings; // Guarded by m_landingMutex
+};
+
+#endif // SNOWSIMULATION_H
@@ -0,0 +1,82 @@
+#include "spatialgrid.h"
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::reset(const QSize &area, int cellSize) {
+  m_cellSize = cellSize;
+  m_cols = (area.width() + cellSize - 1) / cellSize;
+  m_rows = (area.height() + cellSize - 1) / cellSize;
+  m_cells = QVector<QVector<int>>(m_cols * m_rows);
+  m_spans.clear();
+}
+
+void SpatialGrid::clear() {
+  for (auto &cell : m_cells)
+    cell.clear();
+  m_spans.clear();
+}
+
+int SpatialGrid::cellAt(const QPointF &pos) const {
+  int cx = static_cast<int>(std::floor(pos.x() / m_cellSize));
+  int cy = static_cast<int>(std::floor(pos.y() / m_cellSize));
+  if (cx < 0 || cy < 0 || cx >= m_cols || cy >= m_rows)
+    return -1;
+  return cy * m_cols + cx;
+}
+
+SpatialGrid::Span SpatialGrid::spanFor(const QPointF &pos,
+                                       float radius) const {
+  // Items partly outside the grid are clamped to the border cells
+  auto clampCol = [this](double v) {
+    return std::clamp(static_cast<int>(std::floor(v / m_cellSize)), 0,
+                      m_cols - 1);
+  };
+  auto clampRow = [this](double v) {
+    return std::clamp(static_cast<int>(std::floor(v / m_cellSize)), 0,
+                      m_rows - 1);
+  };
+  return {clampCol(pos.x() - radius), clampRow(pos.y() - radius),
+          clampCol(pos.x() + radius), clampRow(pos.y() + radius)};
+}
+
+void SpatialGrid::addToCells(int index, const Span &span) {
+  for (int y = span.y0; y <= span.y1; ++y) {
+    for (int x = span.x0; x <= span.x1; ++x)
+      m_cells[y * m_cols + x].append(index);
+  }
+}
+
+void SpatialGrid::removeFromCells(int index, const Span &span) {
+  for (int y = span.y0; y <= span.y1; ++y) {
+    for (int x = span.x0; x <= span.x1; ++x)
+      m_cells[y * m_cols + x].removeOne(index);
+  }
+}
+
+void SpatialGrid::append(const QPointF &pos, float radius) {
+  Span span = spanFor(pos, radius);
+  addToCells(static_cast<int>(m_spans.size()), span);
+  m_spans.append(span);
+}
+
+void SpatialGrid::move(int index, const QPointF &pos, float radius) {
+  Span span = spanFor(pos, radius);
+  const Span &old = m_spans[index];
+  if (span.x0 == old.x0 && span.y0 == old.y0 && span.x1 == old.x1 &&
+      span.y1 == old.y1)
+    return;
+  removeFromCells(index, old);
+  addToCells(index, span);
+  m_spans[index] = span;
+}
+
+void SpatialGrid::removeAt(int index) {
+  removeFromCells(index, m_spans[index]);
+  m_spans.removeAt(index);
+  for (auto &cell : m_cells) {
+    for (int &i : cell) {
+      if (i > index)
+        --i;
+    }
+  }
+}
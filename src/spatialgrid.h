@@ -0,0 +1,55 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QPointF>
+#include <QSize>
+#include <QVector>
+
+// Uniform grid index for picking items by point. Items are identified by
+// their index in the owner's list, so "topmost wins" is simply the highest
+// accepted index in the cell under the point. Insert, move and pick are
+// constant time for bounded item density; removal shifts indices and is
+// linear, like the QVector::removeAt it mirrors.
+class SpatialGrid {
+public:
+  void reset(const QSize &area, int cellSize = 32);
+  void clear();
+
+  // Registers the next item index with a circle of the given pick radius
+  void append(const QPointF &pos, float radius);
+  void move(int index, const QPointF &pos, float radius);
+  void removeAt(int index);
+
+  // Highest item index in the cell under `pos` for which accept(index)
+  // returns true, or -1.
+  template <typename Accept>
+  int pick(const QPointF &pos, Accept accept) const {
+    int cell = cellAt(pos);
+    if (cell < 0)
+      return -1;
+    int best = -1;
+    for (int index : m_cells[cell]) {
+      if (index > best && accept(index))
+        best = index;
+    }
+    return best;
+  }
+
+private:
+  struct Span {
+    int x0, y0, x1, y1; // inclusive cell range
+  };
+
+  int cellAt(const QPointF &pos) const;
+  Span spanFor(const QPointF &pos, float radius) const;
+  void addToCells(int index, const Span &span);
+  void removeFromCells(int index, const Span &span);
+
+  int m_cellSize = 32;
+  int m_cols = 0;
+  int m_rows = 0;
+  QVector<QVector<int>> m_cells;
+  QVector<Span> m_spans;
+};
+
+#endif // SPATIALGRID_H
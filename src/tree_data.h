@@ -3,9 +3,21 @@
 
 #include <QColor>
 #include <QPointF>
+#include <QRect>
 #include <QString>
 #include <QVector>
 
+enum class OrnamentType : quint8 {
+  Red,
+  Gold,
+  Blue,
+  Silver,
+  Purple,
+  Star,
+  Message,
+  Gift
+};
+
 enum class GiftColor { Red, Blue, Gold };
 enum class GiftSize { Small, Medium, Large };
 
@@ -16,13 +28,23 @@ struct GiftOption {
 };
 
 struct Gift {
-  QPointF pos;
-  float currentY;
-  float targetY;
-  float rotation;
+  QPointF pos;    // Mirrors the gift's physics body
+  float rotation; // Degrees, likewise
   GiftColor color;
   GiftSize size;
-  float fallSpeed = 2.0f;
+  QRect dirtyRect; // Area last invalidated for this gift
 };
 
+inline float giftSide(GiftSize size) {
+  switch (size) {
+  case GiftSize::Small:
+    return 20.0f;
+  case GiftSize::Medium:
+    return 30.0f;
+  case GiftSize::Large:
+    return 45.0f;
+  }
+  return 30.0f;
+}
+
 #endif // TREE_DATA_H
@@ -0,0 +1,110 @@
+#include "treemask.h"
+#include <QBitmap>
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Two-pass 8-neighbour chamfer transform: distance from every non-zero seed
+// to the nearest zero seed.
+void chamfer(QVector<float> &d, int w, int h) {
+  const float a = 1.0f;
+  const float b = 1.41421356f;
+  auto at = [&](int x, int y) -> float & { return d[y * w + x]; };
+
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      float v = at(x, y);
+      if (x > 0)
+        v = std::min(v, at(x - 1, y) + a);
+      if (y > 0) {
+        v = std::min(v, at(x, y - 1) + a);
+        if (x > 0)
+          v = std::min(v, at(x - 1, y - 1) + b);
+        if (x < w - 1)
+          v = std::min(v, at(x + 1, y - 1) + b);
+      }
+      at(x, y) = v;
+    }
+  }
+
+  for (int y = h - 1; y >= 0; --y) {
+    for (int x = w - 1; x >= 0; --x) {
+      float v = at(x, y);
+      if (x < w - 1)
+        v = std::min(v, at(x + 1, y) + a);
+      if (y < h - 1) {
+        v = std::min(v, at(x, y + 1) + a);
+        if (x < w - 1)
+          v = std::min(v, at(x + 1, y + 1) + b);
+        if (x > 0)
+          v = std::min(v, at(x - 1, y + 1) + b);
+      }
+      at(x, y) = v;
+    }
+  }
+}
+} // namespace
+
+void TreeMask::build(const QPainterPath &path, const QSize &size) {
+  m_width = size.width();
+  m_height = size.height();
+
+  // Tree in black on white: QBitmap::fromImage maps black to color1, which
+  // is what QRegion(QBitmap) treats as inside
+  QImage image(size, QImage::Format_Grayscale8);
+  image.fill(Qt::white);
+  {
+    QPainter painter(&image);
+    painter.fillPath(path, Qt::black);
+  }
+
+  const int count = m_width * m_height;
+  const float inf = std::numeric_limits<float>::max() / 2;
+  m_inside.resize(count);
+  QVector<float> toOutside(count);
+  QVector<float> toInside(count);
+  for (int y = 0; y < m_height; ++y) {
+    const uchar *line = image.constScanLine(y);
+    for (int x = 0; x < m_width; ++x) {
+      bool inside = line[x] < 128;
+      int i = y * m_width + x;
+      m_inside[i] = inside;
+      toOutside[i] = inside ? inf : 0.0f;
+      toInside[i] = inside ? 0.0f : inf;
+    }
+  }
+
+  chamfer(toOutside, m_width, m_height);
+  chamfer(toInside, m_width, m_height);
+
+  m_distance.resize(count);
+  for (int i = 0; i < count; ++i)
+    m_distance[i] = m_inside[i] ? -toOutside[i] : toInside[i];
+
+  m_region = QRegion(QBitmap::fromImage(
+      image.convertToFormat(QImage::Format_Mono, Qt::ThresholdDither)));
+}
+
+bool TreeMask::contains(const QPointF &pos) const {
+  int x = static_cast<int>(std::floor(pos.x()));
+  int y = static_cast<int>(std::floor(pos.y()));
+  if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+    return false;
+  return m_inside[y * m_width + x];
+}
+
+float TreeMask::distance(const QPointF &pos) const {
+  if (m_distance.isEmpty())
+    return std::numeric_limits<float>::max();
+
+  // Outside the raster, add the distance to its border
+  float px = std::floor(pos.x());
+  float py = std::floor(pos.y());
+  float cx = std::clamp(px, 0.0f, float(m_width - 1));
+  float cy = std::clamp(py, 0.0f, float(m_height - 1));
+  float extra = std::hypot(px - cx, py - cy);
+  return m_distance[int(cy) * m_width + int(cx)] + extra;
+}
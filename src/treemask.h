@@ -0,0 +1,34 @@
+#ifndef TREEMASK_H
+#define TREEMASK_H
+
+#include <QPainterPath>
+#include <QPointF>
+#include <QRegion>
+#include <QSize>
+#include <QVector>
+
+// Rasterized tree silhouette with a signed distance field, rebuilt whenever
+// the tree path changes. Answers "is this point on the tree" and "how far
+// from the outline" in constant time instead of a path winding test.
+class TreeMask {
+public:
+  void build(const QPainterPath &path, const QSize &size);
+
+  bool contains(const QPointF &pos) const;
+  // Approximate distance in pixels to the outline: negative inside the tree,
+  // positive outside.
+  float distance(const QPointF &pos) const;
+
+  // Tree shape as a region, for window masks and input regions
+  const QRegion &region() const { return m_region; }
+  QSize size() const { return QSize(m_width, m_height); }
+
+private:
+  int m_width = 0;
+  int m_height = 0;
+  QVector<quint8> m_inside;
+  QVector<float> m_distance;
+  QRegion m_region;
+};
+
+#endif // TREEMASK_H
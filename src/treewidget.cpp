@@ -1,44 +1,109 @@
 #include "treewidget.h"
+#include "desktopsnow.h"
+#include "frameclock.h"
+#include "profiler.h"
+#include "qualitygovernor.h"
+#include "scenefile.h"
+#include "sinetable.h"
 #include "snowoverlay.h"
 #include "tree_data.h"
 #include <QActionGroup>
 #include <QApplication>
 #include <QColor>
 #include <QContextMenuEvent>
+#include <QFile>
+#include <QFileDialog>
 #include <QFont>
-#include <QFontMetrics>
 #include <QInputDialog>
 #include <QMenu>
 #include <QPainter>
 #include <QPainterPath>
-#include <QRadialGradient>
-#include <QRandomGenerator>
 #include <QRegion>
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+
+namespace {
+// Pulse rates are tuned per tick of the original 30 ms timer
+constexpr float kTickSeconds = 0.030f;
+
+// Message cards draw their colors from this palette
+const QColor kMessagePalette[] = {
+    QColor(220, 20, 60), QColor(46, 139, 87), QColor(30, 144, 255),
+    QColor(255, 215, 0), QColor(255, 69, 0),  QColor(147, 112, 219)};
+constexpr int kMessagePaletteSize =
+    sizeof(kMessagePalette) / sizeof(kMessagePalette[0]);
+
+// Gifts rest on a floor line at the trunk's foot
+constexpr float kGiftFloorY = 465.0f;
+
+// Pulses as angular rate (the old per-tick steps) and scale amplitude
+constexpr float kOrnamentPulseRate = 0.15f / kTickSeconds;
+constexpr float kOrnamentPulseAmplitude = 0.08f;
+constexpr float kMessagePulseRate = 0.05f / kTickSeconds;
+constexpr float kMessagePulseAmplitude = 0.03f;
+
+// Ornaments are picked within 20px at their current pulse scale
+constexpr float kOrnamentPickRadius = 20.0f * (1 + kOrnamentPulseAmplitude);
+
+// Decoration effects
+constexpr int kConfettiPerLanding = 24;
+constexpr float kStarSparkleRadius = 28.0f;
+
+// Effects shrink with the snow when the governor trims density
+int effectBudget(const EffectParticles &effects, const QualityLevel &quality) {
+  return static_cast<int>(effects.capacity() * quality.flakeScale);
+}
+} // namespace
 
 TreeWidget::TreeWidget(QWidget *parent) : QWidget(parent) {
-  setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool |
-                 Qt::NoDropShadowWindowHint);
-  setAttribute(Qt::WA_TranslucentBackground);
+  if (!parent) {
+    setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint |
+                   Qt::Tool | Qt::NoDropShadowWindowHint);
+    setAttribute(Qt::WA_TranslucentBackground);
+  }
   setAttribute(Qt::WA_NoSystemBackground);
   setFixedSize(TREE_WIDTH, TREE_HEIGHT);
 
   setupTreePath();
+  m_ornamentGrid.reset(size());
+  m_giftGrid.reset(size());
+  m_giftPhysics.setBounds(0, TREE_WIDTH, kGiftFloorY);
+  QualityGovernor *governor = QualityGovernor::instance();
+  m_sprites.setGlow(governor->quality().glow);
+  m_sprites.warm(devicePixelRatioF());
+  m_effects.setBudget(effectBudget(m_effects, governor->quality()));
+  connect(governor, &QualityGovernor::qualityChanged, this, [this]() {
+    const QualityLevel &quality = QualityGovernor::instance()->quality();
+    m_effects.setBudget(effectBudget(m_effects, quality));
+    if (quality.glow != m_sprites.glow()) {
+      m_sprites.setGlow(quality.glow);
+      m_sprites.warm(devicePixelRatioF());
+    }
+    update();
+  });
 
-  m_timer = new QTimer(this);
-  connect(m_timer, &QTimer::timeout, this, &TreeWidget::updateAnimations);
-  m_timer->start(30);
+  // Ornaments pulse forever; gifts only animate while their bodies are awake
+  connect(FrameClock::instance(), &FrameClock::frame, this,
+          &TreeWidget::updateAnimations);
+  FrameClock::instance()->registerSource(
+      this, [this]() {
+        return !m_ornaments.isEmpty() || m_giftPhysics.awakeCount() > 0 ||
+               !m_effects.isEmpty() || m_snowCover.hasSnow() || m_showHud;
+      });
 
   setMouseTracking(true);
 }
 
 void TreeWidget::updateMask() {
   // Masking disabled as requested to prevent clipping and allow full-area
-  // interaction setMask(maskRegion);
+  // interaction. The tree shape is precomputed in m_treeMask.region() should
+  // it be re-enabled: setMask(m_treeMask.region());
 }
 
 void TreeWidget::setupTreePath() {
   m_treePath = QPainterPath();
+  m_treeLayerDirty = true;
 
   float w = TREE_WIDTH;
   float h = TREE_HEIGHT;
@@ -74,9 +139,10 @@ void TreeWidget::setupTreePath() {
 
     m_treePath.closeSubpath();
   } else if (m_treeType == TreeType::Procedural) {
-    // Procedural: Randomly generated symmetrical tiers
-    auto *rng = QRandomGenerator::global();
-    int tiers = rng->bounded(3, 7); // 3 to 6 tiers
+    // Procedural: Randomly generated symmetrical tiers, drawn from the
+    // tree seed so a saved scene gets its shape back
+    Rng shape(m_treeSeed);
+    int tiers = shape.bounded(3, 7); // 3 to 6 tiers
     float totalHeight = 400.0f;
     float currentY = 20.0f;
     float tierHeight = totalHeight / tiers;
@@ -90,7 +156,7 @@ void TreeWidget::setupTreePath() {
     for (int i = 0; i < tiers; ++i) {
       float nextY = currentY + tierHeight;
       float nextWidth = currentWidth + (maxWidth - 40.0f) / tiers +
-                        (rng->generateDouble() * 20.0f - 10.0f);
+                        (shape.generateDouble() * 20.0f - 10.0f);
 
       // Outer point of the tier
       rightPoints.append(QPointF(centerX + nextWidth, nextY));
@@ -98,7 +164,7 @@ void TreeWidget::setupTreePath() {
       // Inward "shoulder" point
       currentY = nextY;
       if (i < tiers - 1) {
-        currentWidth = nextWidth - (rng->generateDouble() * 20.0f + 20.0f);
+        currentWidth = nextWidth - (shape.generateDouble() * 20.0f + 20.0f);
         rightPoints.append(QPointF(centerX + currentWidth, currentY));
       }
     }
@@ -109,8 +175,8 @@ void TreeWidget::setupTreePath() {
     }
 
     // Trunk
-    float trunkW = rng->generateDouble() * 30.0f + 30.0f;
-    float trunkH = rng->generateDouble() * 20.0f + 30.0f;
+    float trunkW = shape.generateDouble() * 30.0f + 30.0f;
+    float trunkH = shape.generateDouble() * 20.0f + 30.0f;
     m_treePath.lineTo(centerX + trunkW / 2, currentY);
     m_treePath.lineTo(centerX + trunkW / 2, currentY + trunkH);
     m_treePath.lineTo(centerX - trunkW / 2, currentY + trunkH);
@@ -136,46 +202,292 @@ void TreeWidget::setupTreePath() {
     // Add trunk
     m_treePath.addRect(centerX - 20, 420, 40, 50);
   }
+
+  m_treeMask.build(m_treePath, QSize(TREE_WIDTH, TREE_HEIGHT));
+  m_snowCover.build(m_treeMask, kGiftFloorY);
 }
 
-void TreeWidget::updateAnimations() {
-  // Pulse ornaments
-  for (auto &orn : m_ornaments) {
-    if (orn.type == OrnamentType::Message) {
-      orn.pulsePhase += 0.05f;
-      orn.scale = 1.0f + 0.03f * std::sin(orn.pulsePhase);
-    } else {
-      orn.pulsePhase += 0.15f;
-      orn.scale = 1.0f + 0.08f * std::sin(orn.pulsePhase);
+void TreeWidget::updateAnimations(float dt) {
+  ProfileScope scope("tree.update");
+  QRegion dirty;
+
+  // Ornament pulses are a function of time, evaluated when drawn; a tick
+  // only advances the clock and repaints their peak bounds
+  m_animationTime += dt;
+  if (!m_ornaments.isEmpty()) {
+    if (m_pulseRegionDirty) {
+      m_pulseRegion = QRegion();
+      for (const auto &orn : std::as_const(m_ornaments))
+        m_pulseRegion += orn.dirtyRect();
+      m_pulseRegionDirty = false;
     }
+    dirty += m_pulseRegion;
+  }
+
+  // Gifts: sleeping bodies are skipped by the stage and never listed
+  m_giftPhysics.step(dt);
+  for (int i : m_giftPhysics.moved()) {
+    Gift &gift = m_gifts[i];
+    gift.pos = m_giftPhysics.position(i);
+    gift.rotation = m_giftPhysics.angle(i);
+    m_giftGrid.move(i, gift.pos, giftSide(gift.size) / 2);
+    invalidateItem(gift.dirtyRect, giftBounds(gift), dirty);
+  }
+
+  // Effects: a burst off the top of every gift that just landed, and a
+  // steady twinkle around the stars
+  for (int i : m_giftPhysics.landed()) {
+    const Gift &gift = m_gifts[i];
+    m_effects.confetti(gift.pos - QPointF(0, giftSide(gift.size) / 2),
+                       kConfettiPerLanding);
   }
+  for (int i : std::as_const(m_stars))
+    m_effects.sparkle(m_ornaments[i].pos(), kStarSparkleRadius, dt);
+  m_effects.update(dt, dirty);
+
+  updateSnowCover(dt, dirty);
+
+  if (m_showHud)
+    dirty += hudRect();
+
+  if (!dirty.isEmpty())
+    update(dirty);
+}
 
-  // Update Gifts (Falling)
-  for (auto &gift : m_gifts) {
-    if (gift.currentY < gift.targetY) {
-      gift.currentY += gift.fallSpeed;
-      if (gift.currentY > gift.targetY)
-        gift.currentY = gift.targetY;
-      gift.pos.setY(gift.currentY);
+void TreeWidget::updateSnowCover(float dt, QRegion &dirty) {
+  const int layers = frontSnowLayerCount();
+  for (int i = 0; i < layers; ++i)
+    frontSnowLayer(i)->takeLandings(m_snowLandings);
+  for (const SnowLanding &landing : std::as_const(m_snowLandings))
+    m_snowCover.deposit(landing.x, landing.size);
+  m_snowLandings.clear();
+  m_snowCover.melt(dt);
+
+  // The layers keep colliding with the last surface they were given, so
+  // only a changed cover or a moved window is worth a new one
+  const QPoint treePos = mapToGlobal(QPoint());
+  if (m_snowCover.revision() != m_publishedCover ||
+      treePos != m_publishedTreePos || layers != m_publishedLayerCount) {
+    for (int i = 0; i < layers; ++i) {
+      SnowOverlay *layer = frontSnowLayer(i);
+      layer->setCollider(m_snowCover.surface(),
+                         treePos - layer->mapToGlobal(QPoint()));
     }
+    m_publishedCover = m_snowCover.revision();
+    m_publishedTreePos = treePos;
+    m_publishedLayerCount = layers;
   }
-  update();
+
+  dirty += m_snowCover.takeDirty();
+}
+
+int TreeWidget::frontSnowLayerCount() const {
+  if (m_desktopSnow)
+    return m_desktopSnow->screenCount();
+  return m_frontSnow ? 1 : 0;
+}
+
+SnowOverlay *TreeWidget::frontSnowLayer(int index) const {
+  return m_desktopSnow ? m_desktopSnow->frontLayer(index) : m_frontSnow;
+}
+
+double TreeWidget::pulseAngle(const Ornament &orn) const {
+  float rate = orn.type == OrnamentType::Message ? kMessagePulseRate
+                                                 : kOrnamentPulseRate;
+  return orn.pulsePhase + rate * m_animationTime;
+}
+
+float TreeWidget::ornamentScale(const Ornament &orn) const {
+  float amplitude = orn.type == OrnamentType::Message ? kMessagePulseAmplitude
+                                                      : kOrnamentPulseAmplitude;
+  return 1.0f + amplitude * tableSin(pulseAngle(orn));
+}
+
+QRect TreeWidget::ornamentBounds(const Ornament &orn) const {
+  // Sized for the peak of the pulse, so the bounds only change on moves
+  if (orn.type == OrnamentType::Message) {
+    // Cards hang below the garland and may rotate, so pad by the card's
+    // half diagonal plus its pen
+    float scale = 1.0f + kMessagePulseAmplitude;
+    int length = orn.message < 0 ? 0 : m_messages[orn.message].text.length();
+    float halfW = length * 11.0f * scale + 18.0f;
+    return QRectF(orn.x - halfW, orn.y - 18.0f, 2 * halfW,
+                  25.0f * scale + 48.0f)
+        .toAlignedRect();
+  }
+
+  float scale = 1.0f + kOrnamentPulseAmplitude;
+  float r = (orn.type == OrnamentType::Star ? 30.0f : 18.0f) * scale + 2;
+  return QRectF(orn.x - r, orn.y - r, 2 * r, 2 * r)
+      .toAlignedRect();
+}
+
+QRect TreeWidget::giftBounds(const Gift &gift) const {
+  // Half diagonal covers any rotation, plus the outline pen
+  float r = giftSide(gift.size) * 0.7072f + 2;
+  return QRectF(gift.pos.x() - r, gift.pos.y() - r, 2 * r, 2 * r)
+      .toAlignedRect();
+}
+
+void TreeWidget::invalidateItem(QRect &lastRect, const QRect &bounds,
+                                QRegion &dirty) {
+  dirty += lastRect;
+  dirty += bounds;
+  lastRect = bounds;
 }
 
 void TreeWidget::paintEvent(QPaintEvent *event) {
+  ProfileScope scope("tree.paint");
+  FrameCostScope cost;
+  // Only the invalidated region is repainted; items outside it are skipped
+  const QRegion &dirty = event->region();
   QPainter painter(this);
-  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setClipRegion(dirty);
+  painter.setRenderHint(QPainter::Antialiasing,
+                        QualityGovernor::instance()->quality().antialiasing);
 
   drawTree(painter);
-  drawOrnaments(painter);
+  m_snowCover.draw(painter, dirty.boundingRect());
+  drawOrnaments(painter, dirty);
 
   // Draw Gifts
   for (const auto &gift : m_gifts) {
-    drawGift(painter, gift);
+    if (dirty.intersects(giftBounds(gift)))
+      drawGift(painter, gift);
+  }
+
+  m_effects.draw(painter, dirty);
+
+  if (m_showHud && dirty.intersects(hudRect()))
+    drawHud(painter);
+
+  // Drag latency runs from the first unpainted move to this paint
+  if (m_dragInputNs != 0) {
+    Profiler::recordLatency("input.drag", m_dragInputNs, Profiler::now());
+    m_dragInputNs = 0;
+  }
+}
+
+void TreeWidget::drawHud(QPainter &painter) {
+  const QRect rect = hudRect();
+  const QVector<float> frames = Profiler::frameTimes();
+  float total = 0, worst = 0;
+  for (float ms : frames) {
+    total += ms;
+    worst = std::max(worst, ms);
+  }
+  float mean = frames.isEmpty() ? 0 : total / frames.size();
+
+  painter.save();
+  painter.setPen(Qt::NoPen);
+  painter.setBrush(QColor(0, 0, 0, 180));
+  painter.drawRoundedRect(rect, 6, 6);
+
+  QFont font = painter.font();
+  font.setPixelSize(11);
+  painter.setFont(font);
+  painter.setPen(Qt::white);
+  int x = rect.left() + 8;
+  int y = rect.top() + 16;
+  painter.drawText(x, y, QString("%1 fps  %2 ms  (en kötü %3)")
+                             .arg(mean > 0 ? 1000 / mean : 0, 0, 'f', 0)
+                             .arg(mean, 0, 'f', 1)
+                             .arg(worst, 0, 'f', 1));
+
+  // Frame-time histogram over the recent frames, one bar per bucket
+  struct Bucket {
+    float limit; // ms, exclusive
+    const char *label;
+    QColor color;
+  };
+  const Bucket buckets[] = {
+      {8.5f, "<8", QColor(90, 200, 90)},
+      {17.0f, "<17", QColor(150, 210, 80)},
+      {34.0f, "<34", QColor(230, 200, 60)},
+      {50.0f, "<50", QColor(240, 140, 50)},
+      {INFINITY, "50+", QColor(230, 60, 60)},
+  };
+  int counts[std::size(buckets)] = {};
+  for (float ms : frames) {
+    int i = 0;
+    while (ms >= buckets[i].limit)
+      ++i;
+    ++counts[i];
+  }
+  const int barWidth = 30, barGap = 4, barHeight = 40;
+  const int base = y + 8 + barHeight;
+  for (size_t i = 0; i < std::size(buckets); ++i) {
+    int bx = x + static_cast<int>(i) * (barWidth + barGap);
+    int h = frames.isEmpty() ? 0 : barHeight * counts[i] / frames.size();
+    painter.fillRect(bx, base - h, barWidth, h, buckets[i].color);
+    painter.drawText(QRect(bx, base + 1, barWidth, 12), Qt::AlignCenter,
+                     buckets[i].label);
   }
+  y = base + 26;
+
+  QString items =
+      QString("süs %1  hediye %2").arg(m_ornaments.size()).arg(m_gifts.size());
+  if (m_backSnow || m_frontSnow) {
+    int flakes = (m_backSnow ? m_backSnow->snowflakeCount() : 0) +
+                 (m_frontSnow ? m_frontSnow->snowflakeCount() : 0);
+    items += QString("  kar %1").arg(flakes);
+  }
+  painter.drawText(x, y, items);
+  QualityGovernor *governor = QualityGovernor::instance();
+  y += 14;
+  painter.drawText(x, y, QString("kalite %1/%2  bütçe %3 ms")
+                             .arg(governor->levelCount() - governor->level())
+                             .arg(governor->levelCount())
+                             .arg(governor->budget(), 0, 'f', 1));
+
+  // The costliest scopes, by running average
+  QVector<Profiler::ScopeStat> stats = Profiler::scopeStats();
+  std::sort(stats.begin(), stats.end(), [](const auto &a, const auto &b) {
+    return a.averageMs > b.averageMs;
+  });
+  for (int i = 0; i < std::min<int>(stats.size(), 3); ++i) {
+    y += 14;
+    painter.drawText(x, y, QString("%1  %2 ms")
+                               .arg(QString::fromLatin1(stats[i].name))
+                               .arg(stats[i].averageMs, 0, 'f', 2));
+  }
+  painter.restore();
+}
+
+void TreeWidget::setHudVisible(bool visible) {
+  if (visible == m_showHud)
+    return;
+  m_showHud = visible;
+  if (visible) {
+    m_profilerWasEnabled = Profiler::isEnabled();
+    Profiler::setEnabled(true);
+  } else {
+    Profiler::setEnabled(m_profilerWasEnabled);
+  }
+  update(hudRect());
+  FrameClock::instance()->wake();
 }
 
 void TreeWidget::drawTree(QPainter &painter) {
+  ProfileScope scope("tree.drawTree");
+  // The tree body only changes with its path, type or the device pixel
+  // ratio, so it is rasterized once and composited with a single blit.
+  qreal dpr = devicePixelRatioF();
+  if (m_treeLayerDirty || m_treeLayer.devicePixelRatio() != dpr) {
+    m_treeLayer = QPixmap(size() * dpr);
+    m_treeLayer.setDevicePixelRatio(dpr);
+    m_treeLayer.fill(Qt::transparent);
+
+    QPainter layerPainter(&m_treeLayer);
+    layerPainter.setRenderHint(QPainter::Antialiasing);
+    renderTreeLayer(layerPainter);
+    m_treeLayerDirty = false;
+  }
+
+  painter.drawPixmap(0, 0, m_treeLayer);
+}
+
+void TreeWidget::renderTreeLayer(QPainter &painter) {
   QColor treeColor, strokeColor;
 
   switch (m_treeType) {
@@ -214,10 +526,12 @@ void TreeWidget::drawTree(QPainter &painter) {
   painter.restore();
 }
 
-void TreeWidget::drawOrnaments(QPainter &painter) {
+void TreeWidget::drawOrnaments(QPainter &painter, const QRegion &dirty) {
+  ProfileScope scope("tree.drawOrnaments");
   painter.save();
   for (const auto &orn : m_ornaments) {
-    drawOrnament(painter, orn);
+    if (dirty.intersects(orn.dirtyRect()))
+      drawOrnament(painter, orn);
   }
   painter.restore();
 }
@@ -227,51 +541,21 @@ void TreeWidget::drawOrnament(QPainter &painter, const Ornament &orn) {
     drawMessage(painter, orn);
     return;
   }
-  if (orn.type == OrnamentType::Star) {
-    drawStar(painter, orn.pos, orn.scale);
-    return;
-  }
-
-  painter.save();
-  painter.setBrush(Qt::NoBrush);
-  painter.setPen(Qt::NoPen);
-
-  QColor baseColor = getOrnamentColor(orn.type);
 
-  // Outer Glow
-  float glowSize = 18 * orn.scale;
-  QRadialGradient gradient(orn.pos, glowSize);
-  gradient.setColorAt(0.0, baseColor);
-  gradient.setColorAt(
-      0.4, QColor(baseColor.red(), baseColor.green(), baseColor.blue(), 150));
-  gradient.setColorAt(1.0, Qt::transparent);
-
-  painter.setBrush(gradient);
-  painter.drawEllipse(orn.pos, glowSize, glowSize);
-
-  // Ornament body
-  painter.setBrush(baseColor);
-  painter.setPen(QPen(Qt::white, 1));
-  painter.drawEllipse(orn.pos, 8 * orn.scale, 8 * orn.scale);
-
-  // Highlight
-  painter.setBrush(QColor(255, 255, 255, 180));
-  painter.setPen(Qt::NoPen);
-  painter.drawEllipse(orn.pos + QPointF(-3, -3) * orn.scale, 3 * orn.scale,
-                      3 * orn.scale);
-
-  painter.restore();
+  // Balls and stars are pre-rendered sprites centred on the ornament
+  qreal dpr = painter.device()->devicePixelRatioF();
+  const QPixmap &sprite = m_sprites.sprite(orn.type, ornamentScale(orn), dpr);
+  QSizeF half = sprite.deviceIndependentSize() / 2;
+  painter.drawPixmap(orn.pos() - QPointF(half.width(), half.height()), sprite);
 }
 
 void TreeWidget::drawGift(QPainter &painter, const Gift &gift) {
+  ProfileScope scope("tree.drawGift");
   painter.save();
-  painter.setRenderHint(QPainter::Antialiasing);
   painter.translate(gift.pos);
   painter.rotate(gift.rotation);
 
-  float s = (gift.size == GiftSize::Small
-                 ? 20.0f
-                 : (gift.size == GiftSize::Medium ? 30.0f : 45.0f));
+  float s = giftSide(gift.size);
   QRectF rect(-s / 2, -s / 2, s, s);
 
   QColor base = getGiftColor(gift.color);
@@ -288,140 +572,180 @@ void TreeWidget::drawGift(QPainter &painter, const Gift &gift) {
   painter.restore();
 }
 
-void TreeWidget::drawStar(QPainter &painter, const QPointF &pos, float scale) {
-  painter.save();
-  painter.setBrush(Qt::NoBrush);
-
-  // Outer glow
-  QRadialGradient glow(pos, 30 * scale);
-  glow.setColorAt(0.0, QColor(255, 255, 200, 200));
-  glow.setColorAt(0.5, QColor(255, 200, 0, 100));
-  glow.setColorAt(1.0, Qt::transparent);
-  painter.setBrush(glow);
-  painter.setPen(Qt::NoPen);
-  painter.drawEllipse(pos, 30 * scale, 30 * scale);
-
-  // Star shape
-  painter.setBrush(QColor(255, 220, 0));
-  painter.setPen(QPen(QColor(255, 165, 0), 1.5f));
-
-  QPainterPath path;
-  for (int i = 0; i < 5; ++i) {
-    float angle = -M_PI / 2 + i * 2 * M_PI / 5;
-    QPointF p(pos.x() + 15 * scale * cos(angle),
-              pos.y() + 15 * scale * sin(angle));
-    if (i == 0)
-      path.moveTo(p);
-    else
-      path.lineTo(p);
-
-    angle += M_PI / 5;
-    path.lineTo(pos.x() + 7 * scale * cos(angle),
-                pos.y() + 7 * scale * sin(angle));
-  }
-  path.closeSubpath();
-  painter.drawPath(path);
-  painter.restore();
-}
-
 void TreeWidget::drawMessage(QPainter &painter, const Ornament &orn) {
-  if (orn.text.isEmpty())
+  ProfileScope scope("tree.drawMessage");
+  if (orn.message < 0)
+    return;
+  OrnamentMessage &message = m_messages[orn.message];
+  if (message.text.isEmpty())
     return;
 
-  painter.save();
-  QFont font("Comic Sans MS", 14, QFont::Bold);
-  painter.setFont(font);
-
-  int n = orn.text.length();
-  float charW = 22 * orn.scale;
-  float totalW = n * charW;
-  float startX = orn.pos.x() - totalW / 2.0f;
-  float sagHeight = 25.0f * orn.scale;
+  const GarlandLayout &layout =
+      message.layouts.layout(message.text, ornamentScale(orn));
+  const double angle = pulseAngle(orn);
+  qreal dpr = painter.device()->devicePixelRatioF();
 
-  auto getSagY = [&](float progress) {
-    return sagHeight * 4.0f * progress * (1.0f - progress);
-  };
+  painter.save();
+  painter.translate(orn.pos());
 
   // Draw the connecting string
   painter.setPen(QPen(QColor(240, 240, 240), 1.5f));
   painter.setBrush(Qt::NoBrush);
-  QPainterPath garlandPath;
-  for (int i = 0; i <= n * 8; ++i) {
-    float progress = (float)i / (n * 8);
-    float px = startX + progress * totalW;
-    float py = orn.pos.y() + getSagY(progress);
-    if (i == 0)
-      garlandPath.moveTo(px, py);
-    else
-      garlandPath.lineTo(px, py);
-  }
-  painter.drawPath(garlandPath);
-
-  for (int i = 0; i < n; ++i) {
-    QChar c = orn.text[i];
-    if (c.isSpace())
-      continue;
-
-    float pLeft = (float)i / n;
-    float pRight = (float)(i + 1) / n;
-
-    float x1 = startX + pLeft * totalW + 2;
-    float y1 = orn.pos.y() + getSagY(pLeft + 2.0f / totalW);
-    float x2 = startX + pRight * totalW - 2;
-    float y2 = orn.pos.y() + getSagY(pRight - 2.0f / totalW);
-
-    float cx = (x1 + x2) / 2.0f;
-    float cy = (y1 + y2) / 2.0f;
+  painter.drawPolyline(layout.garland);
+
+  // Cards are cached sprites; only their sway is evaluated per frame
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  const QTransform base = painter.transform();
+  for (const auto &card : layout.cards) {
+    int i = card.index;
+    const QColor &cardColor = kMessagePalette[message.colors[i]];
+    const QPixmap &sprite = m_cards.card(message.text[i], cardColor, dpr);
+    QSizeF half = sprite.deviceIndependentSize() / 2;
+
+    float sway = tableSin(angle * 0.5 + i * 0.3) * 1.5f;
+    QTransform transform = base;
+    transform.translate(card.center.x(), card.center.y());
+    transform.rotate(card.angle + sway);
+    painter.setTransform(transform);
+    painter.drawPixmap(QPointF(-half.width(), -half.height()), sprite);
+  }
+  painter.restore();
+}
 
-    QColor cardColor =
-        (i < orn.charColors.size()) ? orn.charColors[i] : Qt::red;
+void TreeWidget::setTreeType(TreeType type) {
+  m_treeType = type;
+  if (type == TreeType::Procedural)
+    m_treeSeed = (quint64(m_rng.next()) << 32) | m_rng.next();
+  setupTreePath();
+  updateMask();
+  update();
+  emit sceneChanged();
+}
 
-    painter.save();
-    painter.translate(cx, cy + 8);
+SceneData TreeWidget::saveScene() const {
+  SceneData scene;
+  scene.treeType = static_cast<quint32>(m_treeType);
+  scene.treeSeed = m_treeSeed;
+  if (m_desktopSnow) {
+    scene.backSnow = m_desktopSnow->backColumnFlakes();
+    scene.frontSnow = m_desktopSnow->frontColumnFlakes();
+  } else {
+    scene.backSnow = m_backSnow ? m_backSnow->snowflakeCount() : -1;
+    scene.frontSnow = m_frontSnow ? m_frontSnow->snowflakeCount() : -1;
+  }
 
-    float angle = std::atan2(y2 - y1, x2 - x1) * 180.0f / M_PI;
-    float sway = std::sin(orn.pulsePhase * 0.5f + i * 0.3f) * 1.5f;
-    painter.rotate(angle + sway);
+  scene.ornaments.reserve(m_ornaments.size());
+  for (const Ornament &orn : m_ornaments) {
+    SceneData::OrnamentRecord record = {};
+    record.x = orn.x;
+    record.y = orn.y;
+    record.pulsePhase = orn.pulsePhase;
+    record.type = static_cast<quint8>(orn.type);
+    record.message = -1;
+    if (orn.message >= 0) {
+      // Pool slots are compacted into file order
+      const OrnamentMessage &message = m_messages[orn.message];
+      record.message = scene.messages.size();
+      scene.messages.append({quint32(scene.text.size()),
+                             quint32(message.text.size())});
+      const char16_t *chars =
+          reinterpret_cast<const char16_t *>(message.text.utf16());
+      scene.text.append(QVector<char16_t>(chars, chars + message.text.size()));
+      scene.colors.append(message.colors);
+    }
+    scene.ornaments.append(record);
+  }
 
-    painter.setPen(QPen(cardColor.darker(), 2));
-    painter.setBrush(cardColor);
-    QRectF rect(-10, -12, 20, 24);
-    painter.drawRoundedRect(rect, 3, 3);
+  scene.gifts.reserve(m_gifts.size());
+  for (int i = 0; i < m_gifts.size(); ++i) {
+    const Gift &gift = m_gifts[i];
+    SceneData::GiftRecord record = {};
+    record.x = gift.pos.x();
+    record.y = gift.pos.y();
+    record.rotation = gift.rotation;
+    record.color = static_cast<quint8>(gift.color);
+    record.size = static_cast<quint8>(gift.size);
+    if (m_giftPhysics.isAsleep(i))
+      record.flags = SceneData::GiftAsleep;
+    scene.gifts.append(record);
+  }
+  return scene;
+}
 
-    painter.setBrush(QColor(0, 0, 0, 100));
-    painter.setPen(Qt::NoPen);
-    painter.drawEllipse(QPointF(-7, -9), 2, 2);
-    painter.drawEllipse(QPointF(7, -9), 2, 2);
+void TreeWidget::loadScene(const SceneData &scene) {
+  if (scene.treeType <= static_cast<quint32>(TreeType::Procedural))
+    m_treeType = static_cast<TreeType>(scene.treeType);
+  m_treeSeed = scene.treeSeed;
+  setupTreePath();
 
-    painter.setPen(Qt::white);
-    painter.drawText(rect, Qt::AlignCenter, QString(c));
-    painter.restore();
+  m_ornaments.clear();
+  m_stars.clear();
+  m_messages.clear();
+  m_freeMessages.clear();
+  m_ornamentGrid.clear();
+  m_ornaments.reserve(scene.ornaments.size());
+  for (const auto &record : scene.ornaments) {
+    if (record.type > static_cast<quint8>(OrnamentType::Gift))
+      continue;
+    Ornament orn;
+    orn.x = record.x;
+    orn.y = record.y;
+    orn.pulsePhase = record.pulsePhase;
+    orn.type = static_cast<OrnamentType>(record.type);
+    if (record.message >= 0) {
+      const auto &span = scene.messages[record.message];
+      OrnamentMessage message;
+      message.text = QString::fromUtf16(scene.text.constData() + span.offset,
+                                        span.length);
+      message.colors = scene.colors.mid(span.offset, span.length);
+      for (quint8 &color : message.colors)
+        color = std::min<int>(color, kMessagePaletteSize - 1);
+      orn.message = m_messages.size();
+      m_messages.append(message);
+    }
+    orn.setDirtyRect(ornamentBounds(orn));
+    if (orn.type == OrnamentType::Star)
+      m_stars.append(m_ornaments.size());
+    m_ornaments.append(orn);
+    m_ornamentGrid.append(orn.pos(), kOrnamentPickRadius);
+  }
+  m_pulseRegionDirty = true;
+
+  m_gifts.clear();
+  m_giftGrid.clear();
+  m_giftPhysics.clear();
+  m_effects.clear();
+  m_gifts.reserve(scene.gifts.size());
+  for (const auto &record : scene.gifts) {
+    if (record.color > static_cast<quint8>(GiftColor::Gold) ||
+        record.size > static_cast<quint8>(GiftSize::Large))
+      continue;
+    Gift gift;
+    gift.pos = QPointF(record.x, record.y);
+    gift.rotation = record.rotation;
+    gift.color = static_cast<GiftColor>(record.color);
+    gift.size = static_cast<GiftSize>(record.size);
+    gift.dirtyRect = giftBounds(gift);
+    float half = giftSide(gift.size) / 2;
+    m_gifts.append(gift);
+    m_giftGrid.append(gift.pos, half);
+    m_giftPhysics.append(gift.pos, half, gift.rotation,
+                         record.flags & SceneData::GiftAsleep);
   }
-  painter.restore();
-}
 
-QColor TreeWidget::getOrnamentColor(OrnamentType type) const {
-  switch (type) {
-  case OrnamentType::Red:
-    return QColor(220, 20, 60);
-  case OrnamentType::Gold:
-    return QColor(255, 215, 0);
-  case OrnamentType::Blue:
-    return QColor(30, 144, 255);
-  case OrnamentType::Silver:
-    return QColor(192, 192, 192);
-  case OrnamentType::Purple:
-    return QColor(147, 112, 219);
-  default:
-    return Qt::white;
+  if (m_desktopSnow && scene.backSnow >= 0 && scene.frontSnow >= 0) {
+    m_desktopSnow->changeSnowIntensity(
+        scene.backSnow - m_desktopSnow->backColumnFlakes(),
+        scene.frontSnow - m_desktopSnow->frontColumnFlakes());
   }
-}
+  if (m_backSnow && scene.backSnow >= 0)
+    m_backSnow->setSnowflakeCount(scene.backSnow);
+  if (m_frontSnow && scene.frontSnow >= 0)
+    m_frontSnow->setSnowflakeCount(scene.frontSnow);
 
-void TreeWidget::setTreeType(TreeType type) {
-  m_treeType = type;
-  setupTreePath();
   updateMask();
   update();
+  FrameClock::instance()->wake();
 }
 
 void TreeWidget::setOrnamentType(OrnamentType type) {
@@ -440,34 +764,118 @@ QColor TreeWidget::getGiftColor(GiftColor color) const {
   return Qt::red;
 }
 
+bool TreeWidget::isOnTree(const QPointF &pos) const {
+  return m_treeMask.contains(pos);
+}
+
+void TreeWidget::addOrnament(const QPointF &pos, OrnamentType type,
+                             const QString &text) {
+  Ornament newOrn;
+  newOrn.setPos(pos);
+  newOrn.type = type;
+  newOrn.pulsePhase = m_rng.generateDouble() * 2.0 * M_PI;
+
+  if (type == OrnamentType::Message) {
+    OrnamentMessage message;
+    message.text = text;
+    message.colors.reserve(text.length());
+    for (int i = 0; i < text.length(); ++i) {
+      // Neighbouring cards never share a color
+      quint8 colorIdx;
+      do {
+        colorIdx = static_cast<quint8>(m_rng.bounded(kMessagePaletteSize));
+      } while (!message.colors.isEmpty() && colorIdx == message.colors.last());
+      message.colors.append(colorIdx);
+    }
+
+    if (m_freeMessages.isEmpty()) {
+      newOrn.message = m_messages.size();
+      m_messages.append(message);
+    } else {
+      newOrn.message = m_freeMessages.takeLast();
+      m_messages[newOrn.message] = message;
+    }
+  }
+
+  newOrn.setDirtyRect(ornamentBounds(newOrn));
+  update(newOrn.dirtyRect());
+  if (newOrn.type == OrnamentType::Star)
+    m_stars.append(m_ornaments.size());
+  m_ornaments.append(newOrn);
+  m_pulseRegionDirty = true;
+  m_ornamentGrid.append(newOrn.pos(), kOrnamentPickRadius);
+  FrameClock::instance()->wake();
+  emit sceneChanged();
+}
+
+void TreeWidget::addGift(const QPointF &pos, GiftColor color, GiftSize size) {
+  Gift newGift;
+  // Start no lower than resting on the floor; the physics takes it from there
+  float half = giftSide(size) / 2;
+  newGift.pos = QPointF(pos.x(), std::min<qreal>(pos.y(), kGiftFloorY - half));
+  newGift.color = color;
+  newGift.size = size;
+  newGift.rotation = m_rng.generateDouble() * 60.0f - 30.0f;
+
+  newGift.dirtyRect = giftBounds(newGift);
+  update(newGift.dirtyRect);
+  m_gifts.append(newGift);
+  m_giftGrid.append(newGift.pos, half);
+  m_giftPhysics.append(newGift.pos, half, newGift.rotation);
+  FrameClock::instance()->wake();
+  emit sceneChanged();
+}
+
+int TreeWidget::ornamentAt(const QPointF &pos) const {
+  return m_ornamentGrid.pick(pos, [&](int i) {
+    const Ornament &orn = m_ornaments[i];
+    return QLineF(pos, orn.pos()).length() < 20 * ornamentScale(orn);
+  });
+}
+
+int TreeWidget::giftAt(const QPointF &pos) const {
+  return m_giftGrid.pick(pos, [&](int i) {
+    const Gift &gift = m_gifts[i];
+    return QLineF(pos, gift.pos).length() < giftSide(gift.size) / 2;
+  });
+}
+
 void TreeWidget::mousePressEvent(QMouseEvent *event) {
   if (event->button() == Qt::LeftButton) {
     m_lastPressPos = event->position();
 
-    m_draggedIndex = -1;
-    for (int i = m_ornaments.size() - 1; i >= 0; --i) {
-      float dist = QLineF(event->position(), m_ornaments[i].pos).length();
-      if (dist < 20 * m_ornaments[i].scale) {
-        m_draggedIndex = i;
-        m_dragOffset = m_ornaments[i].pos - event->position();
-        break;
-      }
-    }
+    m_draggedIndex = ornamentAt(event->position());
+    if (m_draggedIndex != -1)
+      m_dragOffset = m_ornaments[m_draggedIndex].pos() - event->position();
 
     if (m_draggedIndex == -1) {
       m_isWindowDragging = true;
-      m_windowDragStartPos =
-          event->globalPosition().toPoint() - frameGeometry().topLeft();
-      m_potentialAddOrnament = m_treePath.contains(event->position());
+      QPoint origin =
+          isWindow() ? frameGeometry().topLeft() : mapToGlobal(QPoint(0, 0));
+      m_windowDragStartPos = event->globalPosition().toPoint() - origin;
+      m_potentialAddOrnament = isOnTree(event->position());
     }
   }
 }
 
 void TreeWidget::mouseMoveEvent(QMouseEvent *event) {
   if (m_draggedIndex != -1) {
-    m_ornaments[m_draggedIndex].pos = event->position() + m_dragOffset;
+    if (Profiler::isEnabled() && m_dragInputNs == 0)
+      m_dragInputNs = Profiler::now();
+    Ornament &orn = m_ornaments[m_draggedIndex];
+    QPointF from = orn.pos();
+    orn.setPos(event->position() + m_dragOffset);
+    m_effects.glitter(from, orn.pos(),
+                      OrnamentSpriteCache::baseColor(orn.type));
+    m_ornamentGrid.move(m_draggedIndex, orn.pos(), kOrnamentPickRadius);
+    QRegion dirty;
+    QRect bounds = ornamentBounds(orn);
+    dirty += orn.dirtyRect();
+    dirty += bounds;
+    orn.setDirtyRect(bounds);
+    m_pulseRegionDirty = true;
     updateMask();
-    update();
+    update(dirty);
   } else if (m_isWindowDragging) {
     QPointF travel = event->position() - m_lastPressPos;
     if (travel.manhattanLength() > 5) {
@@ -475,6 +883,14 @@ void TreeWidget::mouseMoveEvent(QMouseEvent *event) {
     }
 
     QPoint newPos = event->globalPosition().toPoint() - m_windowDragStartPos;
+    if (!isWindow()) {
+      // Composited scene: the window follows horizontally and the tree
+      // slides vertically inside it, keeping the snow column full height
+      QWidget *scene = window();
+      scene->move(newPos.x() - x(), scene->y());
+      move(x(), newPos.y() - scene->mapToGlobal(QPoint(0, 0)).y());
+      return;
+    }
     move(newPos);
     if (m_backSnow) {
       m_backSnow->move(newPos.x(), 0);
@@ -490,23 +906,7 @@ void TreeWidget::mouseReleaseEvent(QMouseEvent *event) {
     bool handled = false;
 
     if (m_giftPlacementMode) {
-      Gift newGift;
-      QPointF clickPos = event->position();
-      // Clamp Y to the floor (450.0f)
-      float floorY = 450.0f;
-      if (clickPos.y() > floorY)
-        clickPos.setY(floorY);
-
-      newGift.pos = clickPos;
-      newGift.currentY = clickPos.y();
-      newGift.targetY = floorY;
-      newGift.color = m_nextGiftColor;
-      newGift.size = m_nextGiftSize;
-
-      auto *rng = QRandomGenerator::global();
-      newGift.rotation = rng->generateDouble() * 60.0f - 30.0f;
-
-      m_gifts.append(newGift);
+      addGift(event->position(), m_nextGiftColor, m_nextGiftSize);
       m_giftPlacementMode = false;
       handled = true;
     } else if (m_potentialAddOrnament && m_draggedIndex == -1) {
@@ -516,43 +916,19 @@ void TreeWidget::mouseReleaseEvent(QMouseEvent *event) {
             this, "Mesaj Ekle", "Ağaca asılacak mesaj:", QLineEdit::Normal, "",
             &ok);
         if (ok && !text.isEmpty()) {
-          Ornament newOrn;
-          newOrn.pos = event->position();
-          newOrn.type = m_currentOrnamentType;
-          newOrn.pulsePhase =
-              QRandomGenerator::global()->generateDouble() * 2.0 * M_PI;
-          newOrn.text = text;
-          QVector<QColor> colors = {
-              QColor(220, 20, 60), QColor(46, 139, 87), QColor(30, 144, 255),
-              QColor(255, 215, 0), QColor(255, 69, 0),  QColor(147, 112, 219)};
-          for (int i = 0; i < text.length(); ++i) {
-            int colorIdx;
-            QColor newColor;
-            do {
-              colorIdx = QRandomGenerator::global()->bounded(colors.size());
-              newColor = colors[colorIdx];
-            } while (!newOrn.charColors.isEmpty() &&
-                     newColor == newOrn.charColors.last());
-            newOrn.charColors.append(newColor);
-          }
-          m_ornaments.append(newOrn);
+          addOrnament(event->position(), m_currentOrnamentType, text);
           handled = true;
         }
       } else {
-        Ornament newOrn;
-        newOrn.pos = event->position();
-        newOrn.type = m_currentOrnamentType;
-        newOrn.pulsePhase =
-            QRandomGenerator::global()->generateDouble() * 2.0 * M_PI;
-        m_ornaments.append(newOrn);
+        addOrnament(event->position(), m_currentOrnamentType);
         handled = true;
       }
     }
 
-    if (handled) {
+    if (handled)
       updateMask();
-      update();
-    }
+    if (m_draggedIndex != -1)
+      emit sceneChanged(); // an ornament was moved
 
     m_draggedIndex = -1;
     m_isWindowDragging = false;
@@ -566,44 +942,43 @@ void TreeWidget::contextMenuEvent(QContextMenuEvent *event) {
 
   QMenu menu(this);
 
-  // Check for ornament near click position
-  int clickedOrnIndex = -1;
-  for (int i = m_ornaments.size() - 1; i >= 0; --i) {
-    float dist = QLineF(event->pos(), m_ornaments[i].pos).length();
-    if (dist < 20 * m_ornaments[i].scale) {
-      clickedOrnIndex = i;
-      break;
-    }
-  }
-
-  // Check for gift near click position
-  int clickedGiftIndex = -1;
-  for (int i = m_gifts.size() - 1; i >= 0; --i) {
-    float dist = QLineF(event->pos(), m_gifts[i].pos).length();
-    float s = (m_gifts[i].size == GiftSize::Small
-                   ? 20.0f
-                   : (m_gifts[i].size == GiftSize::Medium ? 30.0f : 45.0f));
-    if (dist < s / 2) {
-      clickedGiftIndex = i;
-      break;
-    }
-  }
+  // Check for ornament or gift near click position
+  int clickedOrnIndex = ornamentAt(event->pos());
+  int clickedGiftIndex = giftAt(event->pos());
 
   if (clickedOrnIndex != -1) {
     QAction *removeAction = menu.addAction("Süsü Kaldır");
     connect(removeAction, &QAction::triggered, this, [this, clickedOrnIndex]() {
+      const Ornament &orn = m_ornaments[clickedOrnIndex];
+      update(orn.dirtyRect());
+      if (orn.message >= 0) {
+        m_messages[orn.message] = OrnamentMessage();
+        m_freeMessages.append(orn.message);
+      }
+      m_stars.removeOne(clickedOrnIndex);
+      for (int &star : m_stars) {
+        if (star > clickedOrnIndex)
+          --star;
+      }
       m_ornaments.removeAt(clickedOrnIndex);
+      m_ornamentGrid.removeAt(clickedOrnIndex);
+      m_pulseRegionDirty = true;
       updateMask();
-      update();
+      emit sceneChanged();
     });
     menu.addSeparator();
   } else if (clickedGiftIndex != -1) {
     QAction *removeAction = menu.addAction("Hediyeyi Kaldır");
     connect(removeAction, &QAction::triggered, this,
             [this, clickedGiftIndex]() {
+              update(m_gifts[clickedGiftIndex].dirtyRect);
               m_gifts.removeAt(clickedGiftIndex);
+              m_giftGrid.removeAt(clickedGiftIndex);
+              // Gifts resting on it wake up and fall
+              m_giftPhysics.removeAt(clickedGiftIndex);
+              FrameClock::instance()->wake();
               updateMask();
-              update();
+              emit sceneChanged();
             });
     menu.addSeparator();
   }
@@ -642,17 +1017,53 @@ void TreeWidget::contextMenuEvent(QContextMenuEvent *event) {
   QAction *decSnowAction = menu.addAction("Karı Azalt");
 
   connect(incSnowAction, &QAction::triggered, this, [this]() {
+    if (m_desktopSnow)
+      m_desktopSnow->changeSnowIntensity(50, 20);
     if (m_backSnow)
       m_backSnow->changeSnowIntensity(50);
     if (m_frontSnow)
       m_frontSnow->changeSnowIntensity(20);
+    emit sceneChanged();
   });
 
   connect(decSnowAction, &QAction::triggered, this, [this]() {
+    if (m_desktopSnow)
+      m_desktopSnow->changeSnowIntensity(-50, -20);
     if (m_backSnow)
       m_backSnow->changeSnowIntensity(-50);
     if (m_frontSnow)
       m_frontSnow->changeSnowIntensity(-20);
+    emit sceneChanged();
+  });
+
+  menu.addSeparator();
+
+  QAction *exportAction = menu.addAction("Sahneyi JSON Olarak Dışa Aktar");
+  connect(exportAction, &QAction::triggered, this, [this]() {
+    QString path = QFileDialog::getSaveFileName(
+        this, "Sahneyi Dışa Aktar", "scene.json", "JSON (*.json)");
+    if (path.isEmpty())
+      return;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(SceneFile::toJson(saveScene()).toJson()) < 0)
+      qWarning("Scene export failed: %s", qPrintable(file.errorString()));
+  });
+
+  QAction *hudAction = menu.addAction("Performans Göstergesi");
+  hudAction->setCheckable(true);
+  hudAction->setChecked(m_showHud);
+  connect(hudAction, &QAction::toggled, this,
+          [this](bool checked) { setHudVisible(checked); });
+
+  QAction *traceAction = menu.addAction("Performans İzini Kaydet...");
+  traceAction->setEnabled(Profiler::hasEvents());
+  connect(traceAction, &QAction::triggered, this, [this]() {
+    QString path = QFileDialog::getSaveFileName(
+        this, "Performans İzini Kaydet", "trace.json", "JSON (*.json)");
+    QString error;
+    if (!path.isEmpty() && !Profiler::writeTrace(path, &error))
+      qWarning("Trace export failed: %s", qPrintable(error));
   });
 
   menu.addSeparator();
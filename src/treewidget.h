@@ -1,40 +1,66 @@
 #ifndef TREEWIDGET_H
 #define TREEWIDGET_H
 
+#include "effectparticles.h"
+#include "giftphysics.h"
+#include "messagecache.h"
+#include "ornamentsprites.h"
+#include "rng.h"
+#include "snowcover.h"
+#include "spatialgrid.h"
 #include "tree_data.h"
+#include "treemask.h"
 #include <QColor>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPainterPath>
+#include <QPixmap>
 #include <QPointF>
-#include <QTimer>
+#include <QRect>
+#include <QRegion>
 #include <QVector>
 #include <QWidget>
 
 enum class TreeType { Classic, Snowy, Dark, Procedural };
 
-enum class OrnamentType {
-  Red,
-  Gold,
-  Blue,
-  Silver,
-  Purple,
-  Star,
-  Message,
-  Gift
+// Packed per-ornament record walked by paint and hit-testing. Message text
+// and colors live in the widget's message pool, so baubles own no heap data.
+struct Ornament {
+  float x = 0.0f;
+  float y = 0.0f;
+  float pulsePhase = 0.0f; // Fixed offset; the pulse itself is f(time)
+  OrnamentType type = OrnamentType::Red;
+  qint32 message = -1; // Index into the message pool, -1 for none
+  // Bounds at peak pulse, last invalidated; widget coordinates fit 16 bits
+  qint16 dirtyX = 0, dirtyY = 0, dirtyWidth = 0, dirtyHeight = 0;
+
+  QPointF pos() const { return QPointF(x, y); }
+  void setPos(const QPointF &p) {
+    x = static_cast<float>(p.x());
+    y = static_cast<float>(p.y());
+  }
+  QRect dirtyRect() const {
+    return QRect(dirtyX, dirtyY, dirtyWidth, dirtyHeight);
+  }
+  void setDirtyRect(const QRect &r) {
+    dirtyX = static_cast<qint16>(r.x());
+    dirtyY = static_cast<qint16>(r.y());
+    dirtyWidth = static_cast<qint16>(r.width());
+    dirtyHeight = static_cast<qint16>(r.height());
+  }
 };
+static_assert(sizeof(Ornament) == 28, "Ornament is meant to stay packed");
 
-struct Ornament {
-  QPointF pos;
-  OrnamentType type;
-  float scale = 1.0f;
-  float pulsePhase = 0.0f;
-  bool isDragging = false;
-  QString text;               // For Message type
-  QVector<QColor> charColors; // Random colors for each cardboard piece
+// Pool entry of a message ornament
+struct OrnamentMessage {
+  QString text;
+  QVector<quint8> colors;     // Per-card index into the message palette
+  MessageRenderCache layouts; // Garland layouts
 };
 
+class DesktopSnow;
 class SnowOverlay;
+struct SceneData;
 
 class TreeWidget : public QWidget {
   Q_OBJECT
@@ -45,6 +71,29 @@ public:
     m_backSnow = back;
     m_frontSnow = front;
   }
+  // Desktop-wide snow does not follow the tree; only intensity is forwarded
+  void setDesktopSnow(DesktopSnow *snow) { m_desktopSnow = snow; }
+
+  // Scene scripting, shared by mouse placement and the benchmark harness
+  bool isOnTree(const QPointF &pos) const;
+  void addOrnament(const QPointF &pos, OrnamentType type,
+                   const QString &text = QString());
+  void addGift(const QPointF &pos, GiftColor color, GiftSize size);
+  int ornamentCount() const { return m_ornaments.size(); }
+  int giftCount() const { return m_gifts.size(); }
+  const TreeMask &treeMask() const { return m_treeMask; }
+
+  // Persistence; loadScene() replaces every item in one pass
+  SceneData saveScene() const;
+  void loadScene(const SceneData &scene);
+
+signals:
+  // Emitted after user-visible edits worth persisting
+  void sceneChanged();
+
+public slots:
+  void updateAnimations(float dt);
+  void setTreeType(TreeType type);
 
 protected:
   void paintEvent(QPaintEvent *event) override;
@@ -54,35 +103,75 @@ protected:
   void contextMenuEvent(QContextMenuEvent *event) override;
 
 private slots:
-  void updateAnimations();
-  void setTreeType(TreeType type);
   void setOrnamentType(OrnamentType type);
 
 private:
   void setupTreePath();
   void updateMask();
   void drawTree(QPainter &painter);
-  void drawOrnaments(QPainter &painter);
+  void renderTreeLayer(QPainter &painter);
+  void drawOrnaments(QPainter &painter, const QRegion &dirty);
   void drawOrnament(QPainter &painter, const Ornament &orn);
-  void drawStar(QPainter &painter, const QPointF &pos, float scale);
   void drawMessage(QPainter &painter, const Ornament &orn);
   void drawGift(QPainter &painter, const Gift &gift);
-  QColor getOrnamentColor(OrnamentType type) const;
+  void drawHud(QPainter &painter);
+  QRect hudRect() const { return QRect(8, 8, 184, 160); }
+  void setHudVisible(bool visible);
+  void updateSnowCover(float dt, QRegion &dirty);
+  int frontSnowLayerCount() const;
+  SnowOverlay *frontSnowLayer(int index) const;
+  int ornamentAt(const QPointF &pos) const;
+  int giftAt(const QPointF &pos) const;
+  double pulseAngle(const Ornament &orn) const;
+  float ornamentScale(const Ornament &orn) const;
+  QRect ornamentBounds(const Ornament &orn) const;
+  QRect giftBounds(const Gift &gift) const;
+  static void invalidateItem(QRect &lastRect, const QRect &bounds,
+                             QRegion &dirty);
   QColor getGiftColor(GiftColor color) const;
 
   // State
   TreeType m_treeType = TreeType::Classic;
+  quint64 m_treeSeed = 0; // Shape of the procedural tree
   OrnamentType m_currentOrnamentType = OrnamentType::Red;
   GiftColor m_nextGiftColor = GiftColor::Red;
   GiftSize m_nextGiftSize = GiftSize::Medium;
   bool m_giftPlacementMode = false;
 
   QPainterPath m_treePath;
+  TreeMask m_treeMask; // Rasterized m_treePath for O(1) queries
+  QPixmap m_treeLayer;
+  bool m_treeLayerDirty = true;
   QVector<Ornament> m_ornaments;
+  QVector<int> m_stars; // Indices of star ornaments, ascending
+  QVector<OrnamentMessage> m_messages; // Slots referenced by Ornament::message
+  QVector<int> m_freeMessages;         // Reusable m_messages slots
   QVector<Gift> m_gifts;
-  QTimer *m_timer;
+  GiftPhysics m_giftPhysics; // Bodies parallel to m_gifts
+  EffectParticles m_effects; // Sparkles, confetti and glitter
+  double m_animationTime = 0.0; // Seconds of animation shown so far
+  QRegion m_pulseRegion;        // Union of ornament dirtyRects
+  bool m_pulseRegionDirty = false;
+  SpatialGrid m_ornamentGrid; // Pick index, parallel to m_ornaments
+  SpatialGrid m_giftGrid;     // Pick index, parallel to m_gifts
+  OrnamentSpriteCache m_sprites;
+  CardSpriteCache m_cards;
+  Rng m_rng = Rng::forSubsystem("tree"); // Tree shapes, pulses, colors
   SnowOverlay *m_backSnow = nullptr;
   SnowOverlay *m_frontSnow = nullptr;
+  DesktopSnow *m_desktopSnow = nullptr;
+
+  // Settled snow, and the state of it the front layers last collided with
+  SnowCover m_snowCover;
+  QVector<SnowLanding> m_snowLandings; // Reused each tick
+  int m_publishedCover = -1;           // SnowCover::revision()
+  QPoint m_publishedTreePos;           // Global position of column 0
+  int m_publishedLayerCount = 0;
+
+  // Profiling overlay
+  bool m_showHud = false;
+  bool m_profilerWasEnabled = false; // Restored when the HUD closes
+  qint64 m_dragInputNs = 0;          // Oldest drag move not yet painted
 
   // Drag and Drop
   int m_draggedIndex = -1;
@@ -0,0 +1,42 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free single-producer / single-consumer triple buffer. The writer
+// fills writeBuffer() and publish()es it; the reader's read() returns the
+// newest published buffer. Neither side ever blocks, and the reader never
+// sees a buffer that is being written.
+template <typename T> class TripleBuffer {
+public:
+  // Writer side
+  T &writeBuffer() { return m_buffers[m_write]; }
+  void publish() {
+    int previous =
+        m_middle.exchange(m_write | kFresh, std::memory_order_acq_rel);
+    m_write = previous & kIndexMask;
+  }
+
+  // Reader side
+  const T &read() {
+    if (m_middle.load(std::memory_order_relaxed) & kFresh) {
+      int previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+      m_read = previous & kIndexMask;
+    }
+    return m_buffers[m_read];
+  }
+  bool hasFresh() const {
+    return m_middle.load(std::memory_order_relaxed) & kFresh;
+  }
+
+private:
+  static constexpr int kIndexMask = 3;
+  static constexpr int kFresh = 4;
+
+  T m_buffers[3];
+  int m_write = 0;
+  std::atomic<int> m_middle{1};
+  int m_read = 2;
+};
+
+#endif // TRIPLEBUFFER_H